@@ -21,6 +21,10 @@
 #include <ostream>
 #include <limits>
 
+#if defined(__AVX__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
 // next two are for M_PI
 #define _USE_MATH_DEFINES
 #include <cmath>
@@ -66,12 +70,16 @@ namespace pdftoedn
     PdfTM::PdfTM(double radians, double ox, double oy) :
         m11(cos(radians)), m21(sin(radians)), m12(-sin(radians)), m22(cos(radians)),
         dx(ox), dy(oy)
-    { }
+    {
+        update_rotation();
+    }
 
     PdfTM::PdfTM(double radians, const Coord& c) :
         m11(cos(radians)), m21(sin(radians)), m12(-sin(radians)), m22(cos(radians)),
         dx(c.x), dy(c.y)
-    { }
+    {
+        update_rotation();
+    }
 
 
     //
@@ -103,6 +111,7 @@ namespace pdftoedn
     {
         m11 *= sx; m12 *= sx;
         m21 *= sy; m22 *= sy;
+        update_rotation();
     }
 
     // multiply two matrices
@@ -119,30 +128,18 @@ namespace pdftoedn
     }
 
     //
-    // is it rotated along the x,y axes
-    bool PdfTM::is_rotation_orthogonal() const
+    // compute the rotation angle (radians and degrees, the latter
+    // always >= 0) and whether it is rotated along the x,y axes. Text
+    // checks these for every glyph so they're cached on the matrix
+    void PdfTM::update_rotation()
     {
-        double rot = rotation_deg();
-        return (rot == 0 || rot == 90 || rot == 180 || rot == 270);
-    }
-
-    //
-    // rotation angle in radians
-    double PdfTM::rotation() const
-    {
-        return std::atan2(m21, m11);
-    }
-
-    //
-    // rotation in degrees - always > 0
-    double PdfTM::rotation_deg() const
-    {
-        double angle = rotation() * RAD2DEG;
-        if (angle < 0) {
-            angle = 360 + angle;
+        rot_rad = std::atan2(m21, m11);
+        rot_deg = rot_rad * RAD2DEG;
+        if (rot_deg < 0) {
+            rot_deg = 360 + rot_deg;
         }
         // do we need to worry about angles > 359 || < -359? hmm...
-        return angle;
+        rot_orthogonal = (rot_deg == 0 || rot_deg == 90 || rot_deg == 180 || rot_deg == 270);
     }
 
     double PdfTM::deg_to_rad(double degrees)
@@ -155,6 +152,103 @@ namespace pdftoedn
         return (radians * RAD2DEG);
     }
 
+    //
+    // batched point transform. Uses 4 (AVX) or 2 (SSE2) points per
+    // step when the build targets those; the rest are done one by
+    // one. The same multiply and add order as transform() is used so
+    // results are identical. Min / max are tracked in the same pass -
+    // operands are ordered so NaNs are skipped like Bounds::expand()
+    // does
+    void PdfTM::transform_points(const double* x, const double* y, uintmax_t count,
+                                 double* xy, Bounds& bounds) const
+    {
+        double x_lo = std::numeric_limits<double>::infinity(), y_lo = x_lo;
+        double x_hi = -x_lo, y_hi = -x_lo;
+        uintmax_t i = 0;
+
+#if defined(__AVX__) || defined(__SSE2__)
+        // fold the vector min / max lanes into the scalar ones
+        auto lanes_min = [](const double* lanes, uintmax_t n, double& lo) {
+            for (uintmax_t l = 0; l < n; ++l) { if (lanes[l] < lo) lo = lanes[l]; }
+        };
+        auto lanes_max = [](const double* lanes, uintmax_t n, double& hi) {
+            for (uintmax_t l = 0; l < n; ++l) { if (lanes[l] > hi) hi = lanes[l]; }
+        };
+#endif
+
+#if defined(__AVX__)
+        {
+            const __m256d a = _mm256_set1_pd(m11), b = _mm256_set1_pd(m21);
+            const __m256d c = _mm256_set1_pd(m12), d = _mm256_set1_pd(m22);
+            const __m256d e = _mm256_set1_pd(dx),  f = _mm256_set1_pd(dy);
+            __m256d vx_lo = _mm256_set1_pd(x_lo), vy_lo = vx_lo;
+            __m256d vx_hi = _mm256_set1_pd(x_hi), vy_hi = vx_hi;
+
+            for (; i + 4 <= count; i += 4) {
+                __m256d px = _mm256_loadu_pd(x + i), py = _mm256_loadu_pd(y + i);
+                __m256d tx = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(a, px), _mm256_mul_pd(c, py)), e);
+                __m256d ty = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(b, px), _mm256_mul_pd(d, py)), f);
+
+                // interleave: unpack works within 128-bit lanes so
+                // swap the middle halves
+                __m256d lo = _mm256_unpacklo_pd(tx, ty), hi = _mm256_unpackhi_pd(tx, ty);
+                _mm256_storeu_pd(xy + 2 * i,     _mm256_permute2f128_pd(lo, hi, 0x20));
+                _mm256_storeu_pd(xy + 2 * i + 4, _mm256_permute2f128_pd(lo, hi, 0x31));
+
+                vx_lo = _mm256_min_pd(tx, vx_lo);  vx_hi = _mm256_max_pd(tx, vx_hi);
+                vy_lo = _mm256_min_pd(ty, vy_lo);  vy_hi = _mm256_max_pd(ty, vy_hi);
+            }
+
+            double lanes[4];
+            _mm256_storeu_pd(lanes, vx_lo); lanes_min(lanes, 4, x_lo);
+            _mm256_storeu_pd(lanes, vx_hi); lanes_max(lanes, 4, x_hi);
+            _mm256_storeu_pd(lanes, vy_lo); lanes_min(lanes, 4, y_lo);
+            _mm256_storeu_pd(lanes, vy_hi); lanes_max(lanes, 4, y_hi);
+        }
+#elif defined(__SSE2__)
+        {
+            const __m128d a = _mm_set1_pd(m11), b = _mm_set1_pd(m21);
+            const __m128d c = _mm_set1_pd(m12), d = _mm_set1_pd(m22);
+            const __m128d e = _mm_set1_pd(dx),  f = _mm_set1_pd(dy);
+            __m128d vx_lo = _mm_set1_pd(x_lo), vy_lo = vx_lo;
+            __m128d vx_hi = _mm_set1_pd(x_hi), vy_hi = vx_hi;
+
+            for (; i + 2 <= count; i += 2) {
+                __m128d px = _mm_loadu_pd(x + i), py = _mm_loadu_pd(y + i);
+                __m128d tx = _mm_add_pd(_mm_add_pd(_mm_mul_pd(a, px), _mm_mul_pd(c, py)), e);
+                __m128d ty = _mm_add_pd(_mm_add_pd(_mm_mul_pd(b, px), _mm_mul_pd(d, py)), f);
+
+                _mm_storeu_pd(xy + 2 * i,     _mm_unpacklo_pd(tx, ty));
+                _mm_storeu_pd(xy + 2 * i + 2, _mm_unpackhi_pd(tx, ty));
+
+                vx_lo = _mm_min_pd(tx, vx_lo);  vx_hi = _mm_max_pd(tx, vx_hi);
+                vy_lo = _mm_min_pd(ty, vy_lo);  vy_hi = _mm_max_pd(ty, vy_hi);
+            }
+
+            double lanes[2];
+            _mm_storeu_pd(lanes, vx_lo); lanes_min(lanes, 2, x_lo);
+            _mm_storeu_pd(lanes, vx_hi); lanes_max(lanes, 2, x_hi);
+            _mm_storeu_pd(lanes, vy_lo); lanes_min(lanes, 2, y_lo);
+            _mm_storeu_pd(lanes, vy_hi); lanes_max(lanes, 2, y_hi);
+        }
+#endif
+
+        // scalar fallback & remainder
+        for (; i < count; ++i) {
+            double tx = m11 * x[i] + m12 * y[i] + dx;
+            double ty = m21 * x[i] + m22 * y[i] + dy;
+            xy[2 * i]     = tx;
+            xy[2 * i + 1] = ty;
+
+            if (tx < x_lo) x_lo = tx;
+            if (tx > x_hi) x_hi = tx;
+            if (ty < y_lo) y_lo = ty;
+            if (ty > y_hi) y_hi = ty;
+        }
+
+        bounds.expand(x_lo, y_lo, x_hi, y_hi);
+    }
+
     //
     // debug
     std::ostream& PdfTM::dump(std::ostream& o) const
@@ -413,6 +507,20 @@ namespace pdftoedn
             y_max = c.y;
     }
 
+    //
+    // resize against the limits of a set of points
+    void Bounds::expand(double x_lo, double y_lo, double x_hi, double y_hi)
+    {
+        if (x_lo < x_min)
+            x_min = x_lo;
+        if (x_hi > x_max)
+            x_max = x_hi;
+        if (y_lo < y_min)
+            y_min = y_lo;
+        if (y_hi > y_max)
+            y_max = y_hi;
+    }
+
     //
     // resize against a bounding box
     void Bounds::expand(const BoundingBox& bbox)
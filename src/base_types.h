@@ -35,6 +35,8 @@ namespace pdftoedn
     // module string for error reporting
     extern const char* MODULE;
 
+    class Bounds;
+
     // -------------------------------------------------------
     // abstract base class for all types that need to be returned as
     // ruby objects
@@ -103,19 +105,20 @@ namespace pdftoedn
 
         // constructors
         PdfTM() :
-            m11(1), m21(0), m12(0), m22(1), dx(0), dy(0)
+            m11(1), m21(0), m12(0), m22(1), dx(0), dy(0),
+            rot_rad(0), rot_deg(0), rot_orthogonal(true)
         { }
         PdfTM(const double* const ctm) :
             m11(ctm[A]), m21(ctm[B]),
             m12(ctm[C]), m22(ctm[D]),
             dx(ctm[E]),  dy(ctm[F])
-        { }
+        { update_rotation(); }
         PdfTM(double radians, double ox, double oy);
         PdfTM(double radians, const Coord& c);
         // direct constructor - no matrix manip performed
         PdfTM(double a, double b, double c, double d, double e, double f) :
             m11(a), m21(b), m12(c), m22(d), dx(e), dy(f)
-        { }
+        { update_rotation(); }
 
         // accessors
         double a() const { return m11; }
@@ -132,7 +135,7 @@ namespace pdftoedn
 
         // queries
         bool is_rotated() const { return (!is_zero(m21) && !is_zero(m12)); }
-        bool is_rotation_orthogonal() const;         // is the rotation angle 0, 90, 180 or 270?
+        bool is_rotation_orthogonal() const { return rot_orthogonal; } // is the rotation angle 0, 90, 180 or 270?
         bool is_flipped() const { return ((is_zero(m12) && is_zero(m21)) && (m11 < 0)); }
         bool is_upside_down() const { return ((is_zero(m12) && is_zero(m21)) && (m22 > 0)); }
         bool is_sheared() const;
@@ -164,12 +167,18 @@ namespace pdftoedn
         Coord transform_delta(const Coord& c) const {
             return transform_delta(c.x, c.y);
         }
+        // transform count points at once, writing x, y pairs to xy
+        // and expanding bounds by the results. Values match those of
+        // transform() point by point
+        void transform_points(const double* x, const double* y, uintmax_t count,
+                              double* xy, Bounds& bounds) const;
         double transform_line_width(double w) const {
             Coord p = transform_delta(w, w);
             return std::min(std::abs(p.x), std::abs(p.y));
         }
-        double rotation() const;
-        double rotation_deg() const;
+        // rotation is computed once when the matrix is set up
+        double rotation() const { return rot_rad; }      // radians
+        double rotation_deg() const { return rot_deg; }  // degrees - always >= 0
 
         static double deg_to_rad(double degress);
         static double rad_to_deg(double radians);
@@ -180,7 +189,10 @@ namespace pdftoedn
 
     private:
         double m11, m21, m12, m22, dx, dy;
+        double rot_rad, rot_deg;
+        bool rot_orthogonal;
 
+        void update_rotation();
         static bool is_zero(double v) { return (std::abs(v) < 0.001); }
     };
 
@@ -271,6 +283,8 @@ namespace pdftoedn
         // outside of the range
         void expand(const Coord& c);
         void expand(const BoundingBox& bbox);
+        // by the extremes of a set of coordinates
+        void expand(double x_lo, double y_lo, double x_hi, double y_hi);
         void clip(const BoundingBox& bbox);
 
         // the computed bounding box
@@ -318,18 +332,9 @@ namespace pdftoedn
 
         const BoundingBox& bounding_box() const { return bbox; }
 
-        virtual bool is_positioned_before(const PdfBoxedItem* i) const { return (bbox < i->bbox); }
-
         static const Symbol SYMBOL_ROTATION;
         static const Symbol SYMBOL_XFORM;
         static const Symbol SYMBOL_SHEARED;
-
-        // predicate for sorting a set of boxed items
-        struct lt {
-            bool operator()(const pdftoedn::PdfBoxedItem* const i1, const pdftoedn::PdfBoxedItem* const i2) {
-                return i1->is_positioned_before(i2);
-            }
-        };
     };
 
 } // namespace
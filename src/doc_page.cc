@@ -23,6 +23,9 @@
 #include <list>
 #include <vector>
 #include <algorithm>
+#include <functional>
+#include <cmath>
+#include <limits>
 
 #include <poppler/GfxState.h>
 
@@ -55,22 +58,34 @@ namespace pdftoedn
     static const pdftoedn::Symbol SYMBOL_PAGE_HEIGHT           = "height";
     static const pdftoedn::Symbol SYMBOL_PAGE_ROTATION         = "rotation";
     static const pdftoedn::Symbol SYMBOL_PAGE_HAS_INVISIBLES   = "has_invisible_text";
+    static const pdftoedn::Symbol SYMBOL_PAGE_DECIMATED        = "decimated";
     static const pdftoedn::Symbol SYMBOL_PAGE_TEXT_BOUNDS      = "text_bounds";
     static const pdftoedn::Symbol SYMBOL_PAGE_GFX_BOUNDS       = "gfx_bounds";
     static const pdftoedn::Symbol SYMBOL_PAGE_BOUNDS           = "bounds";
     static const pdftoedn::Symbol SYMBOL_PAGE_LINKS            = "links";
+    static const pdftoedn::Symbol SYMBOL_PAGE_TEXT_LINES       = "lines";
+    static const pdftoedn::Symbol SYMBOL_PAGE_TEXT_BLOCKS      = "blocks";
+    static const pdftoedn::Symbol SYMBOL_PAGE_SHARED_CONTENT   = "shared_content";
 
     static const pdftoedn::Symbol SYMBOL_RESOURCES             = "resources";
     static const pdftoedn::Symbol SYMBOL_RES_COLOR_LIST        = "colors";
     static const pdftoedn::Symbol SYMBOL_RES_FONT_LIST         = "fonts";
     static const pdftoedn::Symbol SYMBOL_RES_IMAGE_BLOBS       = "images";
     static const pdftoedn::Symbol SYMBOL_RES_GLYPHS            = "glyphs";
+    static const pdftoedn::Symbol SYMBOL_RES_PATTERNS          = "patterns";
+    static const pdftoedn::Symbol SYMBOL_RES_FORMS             = "forms";
 
     static const pdftoedn::Symbol SYMBOL_COLOR_IDX             = "color_idx";
     static const pdftoedn::Symbol SYMBOL_OPACITY               = "opacity";
 
     static const pdftoedn::Symbol SYMBOL_EQUIVALENT_FONTS      = "equivalent_doc_fonts";
 
+    // size (in points) of the cells used to index items by location
+    const double PdfPage::GRID_CELL_SIZE = 32.0;
+
+    // page coordinates are in points
+    static const double POINTS_PER_INCH = 72.0;
+
     // ==================================================================
     //
     //
@@ -79,10 +94,10 @@ namespace pdftoedn
     // destructor
     PdfPage::~PdfPage()
     {
-        // pdf text spans & images are tracked as pointers sorted in a
-        // set; there are auto_ptr types that let you manage this but,
-        // for now, we just track them directly as pointer and delete
-        // them at the end
+        // pdf text spans & images are tracked as pointers in a vector
+        // and a sorted set; there are auto_ptr types that let you
+        // manage this but, for now, we just track them directly as
+        // pointer and delete them at the end
         util::delete_ptr_container_elems(text_spans);
         util::delete_ptr_container_elems(images);
 
@@ -90,7 +105,6 @@ namespace pdftoedn
         // vector.. we can delete them the same way as the set data
         util::delete_ptr_container_elems(fonts);
         util::delete_ptr_container_elems(colors);
-        util::delete_ptr_container_elems(glyphs);
         util::delete_ptr_container_elems(clip_paths);
         util::delete_ptr_container_elems(graphics);
         util::delete_ptr_container_elems(links);
@@ -128,6 +142,27 @@ namespace pdftoedn
     }
 
 
+    //
+    // text & gfx attribs tables - characters and paths are created
+    // in runs that share the same attribs so check the last entry
+    // returned before hashing
+    const TextAttribs* PdfPage::register_text_attribs(const TextAttribs& attribs)
+    {
+        if (!last_text_attribs || *last_text_attribs != attribs) {
+            last_text_attribs = &(*text_attribs_table.insert(attribs).first);
+        }
+        return last_text_attribs;
+    }
+
+    const GfxAttribs* PdfPage::register_gfx_attribs(const GfxAttribs& attribs)
+    {
+        if (!last_gfx_attribs || !GfxAttribs::eq()(*last_gfx_attribs, attribs)) {
+            last_gfx_attribs = &(*gfx_attribs_table.insert(attribs).first);
+        }
+        return last_gfx_attribs;
+    }
+
+
     //
     // looks up the index of a font by family & style
     intmax_t PdfPage::get_font_index(const PdfFont& font) const
@@ -291,23 +326,27 @@ namespace pdftoedn
         }
 
         // set the clipping path, if applicable
-        intmax_t span_clip_path_id = span->clip_id();
-        if (span_clip_path_id != -1) {
+        if (span->clip_id() != -1) {
+            // drop it if clipped out
+            if (clip_region_empty(cur_text.clip_bbox) ||
+                span_bbox.is_clipped_by(cur_text.clip_bbox) == BoundingBox::FULLY_CLIPPED) {
+                delete span;
+                return false;
+            }
+
             // recalculate the span's clipped bbox - only used for computing text bounds
-            span_bbox = span_bbox.clip( clip_paths[ span_clip_path_id ]->bounding_box() );
+            span_bbox = span_bbox.clip( cur_text.clip_bbox );
         }
 
-#if 0
         // remove any spans this one "overwrites"
-        //
-        // TODO: FIX ME. Should resolve this by keeping paint order of
-        // text along w/ graphics
         if (!span->CTM().is_rotated()) {
             remove_spans_overlapped_by_span( *span );
         }
-#endif
-        // insert it into the list
-        text_spans.insert(text_spans.end(), span);
+
+        // append it to the list and index it by location
+        span->set_paint_seq( paint_seq++ );
+        span_grid.insert( text_spans.size(), span->bounding_box() );
+        text_spans.push_back(span);
 
         // adjust the overall text bounds if needed
         cur_text.bounds.expand( span_bbox );
@@ -315,67 +354,113 @@ namespace pdftoedn
     }
 
     //
-    // checks if the pending span overlaps any already stored spans
-    // and, if so, removes them
-    void PdfPage::remove_spans_overlapped_by_span(const PdfText& pending_span)
+    // deletes a stored span and drops it from the location index. The
+    // slot is cleared and compacted in sort_text_spans()
+    void PdfPage::erase_span(uintmax_t span_idx)
     {
-        std::multiset<PdfBoxedItem*>::const_iterator si, cur = text_spans.begin();
+        PdfText* span = text_spans[span_idx];
+        span_grid.remove(span_idx, span->bounding_box());
+        delete span;
+        text_spans[span_idx] = NULL;
+    }
 
-        // search until no matches are found
-        while (1)
-        {
-            si = std::find_if( cur,
-                               text_spans.end(),
-                               pending_span.overlap_predicate() );
 
-            if (si == text_spans.end()) {
-                break;
+    //
+    // looks up the stored spans whose bboxes share a grid cell with
+    // the given bbox. Each span is returned once
+    void PdfPage::find_span_candidates(const BoundingBox& bbox, std::vector<uintmax_t>& candidates) const
+    {
+        span_grid.query(bbox, candidates);
+
+        std::sort( candidates.begin(), candidates.end() );
+        candidates.erase( std::unique( candidates.begin(), candidates.end() ), candidates.end() );
+    }
+
+
+    //
+    // checks if the pending span overwrites any already stored spans
+    // and, if so, removes them. A span is overwritten if it carries
+    // the same text (fake bold, text painted twice, etc.), mostly
+    // overlaps the new one, and nothing was painted over it in
+    // between - otherwise both are part of the page's layering
+    void PdfPage::remove_spans_overlapped_by_span(const PdfText& pending_span)
+    {
+        std::vector<uintmax_t> candidates;
+        find_span_candidates(pending_span.bounding_box(), candidates);
+
+        PdfText::OverlapPred overlaps = pending_span.overlap_predicate();
+        for (uintmax_t idx : candidates) {
+            PdfText* span = text_spans[idx];
+            if (span->has_same_text(pending_span) && overlaps(span) &&
+                !painted_over_since(span->bounding_box(), span->paint_seq())) {
+                erase_span(idx);
             }
+        }
+    }
 
-            // delete the text span and erase the container
-            cur = std::next(si);
-            delete *si;
-            text_spans.erase(si);
+    //
+    // number a stored graphic (path or image) in paint order and
+    // index its bbox
+    void PdfPage::register_painted_gfx(const BoundingBox& gfx_bbox)
+    {
+        gfx_grid.insert( painted_gfx.size(), gfx_bbox );
+        painted_gfx.push_back( std::make_pair(paint_seq++, gfx_bbox) );
+    }
+
+    //
+    // was any graphic touching the bbox painted after the given
+    // paint sequence number?
+    bool PdfPage::painted_over_since(const BoundingBox& bbox, uintmax_t seq) const
+    {
+        std::vector<uintmax_t> candidates;
+        gfx_grid.query(bbox, candidates);
+
+        for (uintmax_t idx : candidates) {
+            const std::pair<uintmax_t, BoundingBox>& g = painted_gfx[idx];
+            if (g.first > seq && g.second.is_clipped_by(bbox) != BoundingBox::FULLY_CLIPPED) {
+                return true;
+            }
         }
+        return false;
     }
 
 
     //
     // checks if the rectangular region overlaps any already stored
-    // spans and, if so, removes them / truncates them
+    // spans and, if so, removes them / truncates them. Only spans
+    // sharing a grid cell with the region can overlap it
     void PdfPage::remove_spans_overlapped_by_region(const PdfPath& region)
     {
         BoundingBox path_bbox = region.bounding_box();
-        std::multiset<PdfBoxedItem*>::iterator ti = text_spans.begin();
-        while (ti != text_spans.end())
+
+        std::vector<uintmax_t> candidates;
+        find_span_candidates(path_bbox, candidates);
+
+        for (uintmax_t idx : candidates)
         {
-            PdfBoxedItem* span = *ti;
+            PdfText* span = text_spans[idx];
 
             // TODO: re-work rotated text spans to let this work
             if (span->CTM().is_rotated()) {
-                ++ti;
                 continue;
             }
 
-            const BoundingBox& sbbox = span->bounding_box();
+            BoundingBox sbbox = span->bounding_box();
             // TODO: FIX needs to determine if region is covering
             // bottom 80% of box since top 20% is likely blank
             double overlap_ratio = sbbox.intersection_area_ratio(path_bbox);
 
             // approx. rules for now. Anything that's covered less
-            // than 25% we say is not covered
-            if (overlap_ratio < 0.25) {
-                ++ti;
+            // than 25% we say is not covered (this includes
+            // zero-area spans)
+            if (!(overlap_ratio >= 0.25)) {
                 continue;
             }
 
-            std::multiset<PdfBoxedItem*>::const_iterator tmp = ti++;
-
             // anything > 80% is fully covered. Might get some false
             // positives here because the bboxes are approximated
             if (overlap_ratio > 0.8) {
-                delete *tmp;
-                text_spans.erase(tmp);
+                erase_span(idx);
             }
             else {
                 // for ratios between 25% and 80%, check the bbox to
@@ -384,15 +469,16 @@ namespace pdftoedn
                 // assumes horizontal spans so FIX
                 if (sbbox.x_min() < path_bbox.x_min() ||
                     sbbox.x_max() > path_bbox.x_max()) {
-                    PdfText* s = dynamic_cast<PdfText*>(span);
-                    if (s) {
-                        s->whiteout(path_bbox);
-
-                        // if no chars are left, delete it
-                        if (s->length() == 0) {
-                            delete *tmp;
-                            text_spans.erase(tmp);
-                        }
+                    span->whiteout(path_bbox);
+
+                    // if no chars are left, delete it; otherwise
+                    // re-index it with its reduced bbox
+                    span_grid.remove(idx, sbbox);
+                    if (span->length() == 0) {
+                        delete span;
+                        text_spans[idx] = NULL;
+                    } else {
+                        span_grid.insert(idx, span->bounding_box());
                     }
                 }
             }
@@ -400,6 +486,68 @@ namespace pdftoedn
     }
 
 
+    //
+    // drops the slots of removed spans and sorts the rest in reading
+    // order. Spans are first bucketed into lines: sorted by baseline,
+    // a span joins the current line if its baseline is within the
+    // threshold of the line's first span (TESLA-7177: give a small
+    // amount of play when comparing vertical position of text
+    // spans). Lines are then sorted left to right. Both sorts are
+    // stable so spans with equal keys keep their paint order. If
+    // requested, the resulting lines are kept and split into words
+    void PdfPage::sort_text_spans()
+    {
+        text_spans.erase( std::remove(text_spans.begin(), text_spans.end(), (PdfText*) NULL),
+                          text_spans.end() );
+
+        if (text_spans.empty()) {
+            return;
+        }
+
+        std::stable_sort( text_spans.begin(), text_spans.end(),
+                          [](const PdfText* a, const PdfText* b) { return (a->y_max() < b->y_max()); } );
+
+        // assign each span a line number
+        std::vector< std::pair<uintmax_t, PdfText*> > lines;
+        lines.reserve(text_spans.size());
+
+        uintmax_t line = 0;
+        const PdfText* line_start = text_spans.front();
+        for (PdfText* t : text_spans) {
+            if (!(t->y_max() - line_start->y_max() < line_start->baseline_threshold())) {
+                line_start = t;
+                ++line;
+            }
+            lines.push_back( std::make_pair(line, t) );
+        }
+
+        std::stable_sort( lines.begin(), lines.end(),
+                          [](const std::pair<uintmax_t, PdfText*>& a, const std::pair<uintmax_t, PdfText*>& b) {
+                              if (a.first != b.first) {
+                                  return (a.first < b.first);
+                              }
+                              return (a.second->x_min() < b.second->x_min());
+                          } );
+
+        for (uintmax_t i = 0; i < lines.size(); ++i) {
+            text_spans[i] = lines[i].second;
+        }
+
+        if (pdftoedn::options.include_text_lines()) {
+            text_lines.reserve(line + 1);
+
+            uintmax_t first = 0;
+            for (uintmax_t i = 1; i <= lines.size(); ++i) {
+                if (i == lines.size() || lines[i].first != lines[first].first) {
+                    text_lines.push_back( PdfTextLine(first) );
+                    text_lines.back().assemble(text_spans, i - 1);
+                    first = i;
+                }
+            }
+        }
+    }
+
+
     //
     // adds a new character found in the PDF
     void PdfPage::new_character(double x, double y, double w, double h, const PdfTM& ctm,
@@ -421,33 +569,42 @@ namespace pdftoedn
 
         // a font & color must have been set by now otherwise we can't
         // do anything with this
-        if (!ta.are_valid() || cur_gfx.attribs.fill.color_idx == -1)
+        if (!ta.are_valid() || cur_gfx.attribs->fill.color_idx == -1)
         {
             et.log_error( ErrorTracker::ERROR_PAGE_DATA, MODULE, "attempted to add character but no font and/or color have been registered" );
             return;
         }
 
-        if (invisible) {
-            // mark the page as carrying invisible text
-            has_invisible_text = true;
-        }
-
         // new text span.. estimate the bbox using the font height
         // since poppler returns a 0 for horizontal text. If
         // rotated, we use the given height and try to compensate
         // later
         BoundingBox bbox(x, y, w, (ctm.is_rotated() ? h : -ta.font_size));
 
+        // if enabled, drop characters that can't be seen. Otherwise,
+        // only spans fully outside the page or clip are dropped.
+        // Rotated bboxes are only an estimate at this point so those
+        // are always checked per span
+        if (pdftoedn::options.cull_chars() && !ctm.is_rotated() && !is_visible(bbox)) {
+            return;
+        }
+
+        if (invisible) {
+            // mark the page as carrying invisible text
+            has_invisible_text = true;
+        }
+
         ta.invisible = invisible;
         ta.link_idx = inside_link(bbox);
-        PdfChar *c = new PdfChar(bbox, ctm, unicode_c, ta, cur_gfx.attribs,
-                                 metrics, glyph_idx, cur_gfx.clip_path());
+        PdfChar c(bbox, ctm, unicode_c,
+                  register_text_attribs(ta), cur_gfx.attribs,
+                  metrics, glyph_idx, cur_gfx.clip_path());
 
         // check if we've started a span already
         if (cur_text.span)
         {
             // yes, check if we can join them
-            if (!cur_text.span->spans(*c)) {
+            if (!cur_text.span->spans(c)) {
                 // no. push the existing span into the list of
                 // text_spans - this creates a new empty span we'll
                 // append to below
@@ -455,7 +612,11 @@ namespace pdftoedn
             }
         }
 
-        // store the current character
+        // store the current character, noting the clip region if it
+        // starts a span
+        if (!cur_text.span) {
+            cur_text.clip_bbox = cur_gfx.clip_bbox;
+        }
         if (cur_text.push_char(c)) {
 
             if (used_pending_font) {
@@ -466,11 +627,7 @@ namespace pdftoedn
 
             // and update the text attribs
             cur_text.attribs = ta;
-            return;
         }
-
-        // did not get appended for some reason so delete it
-        delete c;
     }
 
     //
@@ -484,11 +641,13 @@ namespace pdftoedn
     }
 
     //
-    // push the current state into the stack
+    // push the current state into the stack - attribs are shared so
+    // this only saves a pointer, plus the clip region's bounds
     void PdfPage::push_gfx_state()
     {
-        //        std::cerr << "     pushing gfx attribs " << std::endl << cur_gfx.attribs << std::endl;
+        //        std::cerr << "     pushing gfx attribs " << std::endl << *cur_gfx.attribs << std::endl;
         cur_gfx.attribs_stack.push( cur_gfx.attribs );
+        cur_gfx.clip_bbox_stack.push( cur_gfx.clip_bbox );
     }
 
     //
@@ -496,9 +655,11 @@ namespace pdftoedn
     void PdfPage::pop_gfx_state()
     {
         if (!cur_gfx.attribs_stack.empty()) {
-            //        std::cerr << "     popping gfx attribs: " << std::endl << cur_gfx.attribs << std::endl;
+            //        std::cerr << "     popping gfx attribs: " << std::endl << *cur_gfx.attribs << std::endl;
             cur_gfx.attribs = cur_gfx.attribs_stack.top();
             cur_gfx.attribs_stack.pop();
+            cur_gfx.clip_bbox = cur_gfx.clip_bbox_stack.top();
+            cur_gfx.clip_bbox_stack.pop();
         }
     }
 
@@ -510,12 +671,133 @@ namespace pdftoedn
         // make sure to push the final span
         mark_end_of_text();
 
+        // drop text output once for the whole document
+        if (shared_content) {
+            remove_shared_spans();
+        }
+
+        // same for repeated path geometry
+        if (path_symbols) {
+            use_path_symbols();
+        }
+
+        // and put the text in reading order
+        sort_text_spans();
+
+        if (pdftoedn::options.include_text_blocks()) {
+            BlockSegmenter(text_spans, rulings).segment(text_blocks);
+        }
+
         if (pdftoedn::options.include_debug_info()) {
             // report any page font issues
             for (const PdfPage::PageFont* f : fonts) { f->log_font_issues(); }
         }
     }
 
+    //
+    // pre-pass: fingerprint the page's spans so text repeated on
+    // other pages can be found
+    void PdfPage::collect_shared_content(SharedContent& shared) const
+    {
+        SharedContent::Key key;
+        for (const PdfText* t : text_spans) {
+            if (t && shared_content_key(*t, key)) {
+                shared.add(key, *t, number);
+            }
+        }
+    }
+
+    //
+    // builds a span's fingerprint using the doc-level font and color
+    // values. Only plain horizontal text is considered - linked,
+    // invisible, translucent spans or those with glyphs stay on the
+    // page
+    bool PdfPage::shared_content_key(const PdfText& span, SharedContent::Key& key) const
+    {
+        const PdfChar::Attribs& attribs = span.char_attribs();
+
+        if (span.CTM().is_rotated() || span.has_glyphs() ||
+            attribs.txt->invisible || attribs.txt->link_idx != -1 ||
+            attribs.txt->font_idx < 0 || attribs.gfx->fill.opacity != 1.0) {
+            return false;
+        }
+
+        const PdfFont* font = fonts[attribs.txt->font_idx]->font();
+        const RGBColor* color = colors[attribs.gfx->fill.color_idx];
+        const BoundingBox& span_bbox = span.bounding_box();
+
+        key.text        = span.text();
+        key.font_family = font->family();
+        key.bold        = font->is_bold();
+        key.italic      = font->is_italic();
+        key.font_size   = std::lround(span.font_size() * 100);
+        key.color       = (color->red() << 16) | (color->green() << 8) | color->blue();
+        key.x1          = std::lround(span_bbox.x_min());
+        key.y1          = std::lround(span_bbox.y_min());
+        key.x2          = std::lround(span_bbox.x_max());
+        key.y2          = std::lround(span_bbox.y_max());
+        return true;
+    }
+
+    //
+    // replace spans found in the doc's shared content by a reference
+    // to the entry
+    void PdfPage::remove_shared_spans()
+    {
+        SharedContent::Key key;
+        for (uintmax_t i = 0; i < text_spans.size(); ++i) {
+            if (!text_spans[i] || !shared_content_key(*text_spans[i], key)) {
+                continue;
+            }
+
+            intmax_t idx = shared_content->find(key);
+            if (idx != -1) {
+                shared_refs.push_back(idx);
+                erase_span(i);
+            }
+        }
+
+        std::sort( shared_refs.begin(), shared_refs.end() );
+        shared_refs.erase( std::unique(shared_refs.begin(), shared_refs.end()), shared_refs.end() );
+    }
+
+    //
+    // pre-pass: fingerprint the page's fill and stroke paths so
+    // shapes repeated anywhere in the document can be found
+    void PdfPage::collect_path_symbols(PathSymbols& symbols) const
+    {
+        PathSymbols::Key key;
+        PdfPath::Commands geometry;
+        Coord origin;
+        for (const PdfGfxCmd* g : graphics) {
+            const PdfDocPath* p = dynamic_cast<const PdfDocPath*>(g);
+            if (p && PathSymbols::make_key(*p, key, geometry, origin)) {
+                symbols.add(key, geometry);
+            }
+        }
+    }
+
+    //
+    // paths matching a document symbol are output as a reference to
+    // it placed at their first point
+    void PdfPage::use_path_symbols()
+    {
+        PathSymbols::Key key;
+        PdfPath::Commands geometry;
+        Coord origin;
+        for (PdfGfxCmd* g : graphics) {
+            PdfDocPath* p = dynamic_cast<PdfDocPath*>(g);
+            if (!p || !PathSymbols::make_key(*p, key, geometry, origin)) {
+                continue;
+            }
+
+            intmax_t idx = path_symbols->find(key);
+            if (idx != -1) {
+                p->set_symbol(idx, origin);
+            }
+        }
+    }
+
     //
     // searches if a clip path has already been defined to avoid
     // duplicates
@@ -531,47 +813,87 @@ namespace pdftoedn
     }
 
 
+    //
+    // conservative bounds of a poppler path on the page: the bbox of
+    // its control points in user space, transformed. Contains the
+    // bounds of the converted path. Returns false if it has no points
+    static bool gfx_path_bounds(GfxPath* path, const PdfTM& ctm, Bounds& bounds)
+    {
+        double x_lo = std::numeric_limits<double>::infinity(), y_lo = x_lo;
+        double x_hi = -x_lo, y_hi = -x_lo;
+
+        for (intmax_t i = 0; i < path->getNumSubpaths(); ++i) {
+            GfxSubpath *subpath = path->getSubpath(i);
+            for (intmax_t j = 0; j < subpath->getNumPoints(); ++j) {
+                double x = subpath->getX(j), y = subpath->getY(j);
+                x_lo = std::min(x_lo, x);  x_hi = std::max(x_hi, x);
+                y_lo = std::min(y_lo, y);  y_hi = std::max(y_hi, y);
+            }
+        }
+
+        if (!(x_lo <= x_hi)) {
+            return false;
+        }
+
+        bounds.expand(ctm.transform(x_lo, y_lo));
+        bounds.expand(ctm.transform(x_hi, y_lo));
+        bounds.expand(ctm.transform(x_hi, y_hi));
+        bounds.expand(ctm.transform(x_lo, y_hi));
+        return true;
+    }
+
     //
     // create and add a new path type
     void PdfPage::add_path(GfxState* state, PdfDocPath::Type type, PdfDocPath::EvenOddRule eo_flag)
     {
-        // convert the poppler path to our own type
-        PdfDocPath* edsel_path = new PdfDocPath(type, cur_gfx.attribs, eo_flag);
-        Coord c1, c2, c3;
         GfxPath* poppler_path = state->getPath();
+        PdfTM ctm(state->getCTM());
+
+        // skip stroke / fill paths that can't be seen before
+        // converting them. Clip paths are always needed
+        Bounds path_bounds;
+        if (type != PdfDocPath::CLIP &&
+            gfx_path_bounds(poppler_path, ctm, path_bounds) && !is_visible(path_bounds.bounding_box())) {
+            return;
+        }
+
+        // once a page's paths have twice the point budget (see
+        // below), stroke and fill paths are dropped without
+        // converting them
+        uintmax_t max_points = pdftoedn::options.max_path_points_per_page();
+        if (type != PdfDocPath::CLIP && max_points > 0 && path_points >= 2 * max_points) {
+            decimated = true;
+            return;
+        }
+
+        // convert the poppler path to our own type
+        PdfDocPath* edsel_path = new PdfDocPath(type, *cur_gfx.attribs, eo_flag);
+
+        // each subpath's points are gathered and transformed in a
+        // single batch
+        std::vector<double> x, y;
+        std::vector<uint8_t> curve;
 
         for (intmax_t i = 0; i < poppler_path->getNumSubpaths(); ++i)
         {
             GfxSubpath *subpath = poppler_path->getSubpath(i);
-
-            if (subpath->getNumPoints() > 0)
-            {
-                // register a new move_to command
-                state->transform(subpath->getX(0), subpath->getY(0), &c1.x, &c1.y);
-                edsel_path->move_to(c1);
-
-                for (intmax_t j = 1; j < subpath->getNumPoints(); j++)
-                {
-                    if (subpath->getCurve(j)) {
-                        // and either a curve_to or
-                        state->transform(subpath->getX(j), subpath->getY(j), &c1.x, &c1.y);
-                        j++;
-                        state->transform(subpath->getX(j), subpath->getY(j), &c2.x, &c2.y);
-                        j++;
-                        state->transform(subpath->getX(j), subpath->getY(j), &c3.x, &c3.y);
-                        edsel_path->curve_to(c1, c2, c3);
-                    }
-                    else {
-                        // a line to
-                        state->transform(subpath->getX(j), subpath->getY(j), &c1.x, &c1.y);
-                        edsel_path->line_to(c1);
-                    }
-                }
-                // if the path is closed, mark it as so
-                if (subpath->isClosed()) {
-                    edsel_path->close();
-                }
+            intmax_t num_points = subpath->getNumPoints();
+
+            x.resize(num_points);
+            y.resize(num_points);
+            curve.resize(num_points);
+            for (intmax_t j = 0; j < num_points; ++j) {
+                x[j] = subpath->getX(j);
+                y[j] = subpath->getY(j);
+                curve[j] = subpath->getCurve(j);
             }
+
+            edsel_path->add_subpath(ctm, x.data(), y.data(), curve.data(), num_points,
+                                    subpath->isClosed());
+        }
+
+        if (pdftoedn::options.compact_paths()) {
+            edsel_path->compact();
         }
 
         //
@@ -593,18 +915,23 @@ namespace pdftoedn
                 //                std::cerr << " --- clip path already exists with id: " << cur_path_idx << std::endl;
             }
 
+            // the clip region is the intersection with the one in
+            // effect
+            const BoundingBox& path_bbox = clip_paths[cur_path_idx]->bounding_box();
+            cur_gfx.clip_bbox = (cur_gfx.clip_path_set() ? path_bbox.clip(cur_gfx.clip_bbox) : path_bbox);
+
             // and set the active clip path
-            cur_gfx.attribs.clip_idx = cur_path_idx;
+            update_gfx_attribs([=](GfxAttribs& a) { a.clip_idx = cur_path_idx; });
         }
         else {
             // stroke / fill paths might be clipped
             if (cur_gfx.clip_path_set()) {
                 // there's a clip path.. Some diagrams contain paths
                 // outside of the clip.
-                const BoundingBox& cb = clip_paths[ cur_gfx.clip_path() ]->bounding_box();
+                const BoundingBox& cb = cur_gfx.clip_bbox;
 
                 BoundingBox::eClipState clip_state = edsel_path->bounding_box().is_clipped_by(cb);
-                if (clip_state == BoundingBox::FULLY_CLIPPED) {
+                if (clip_region_empty(cb) || clip_state == BoundingBox::FULLY_CLIPPED) {
                     // We don't want to store these so delete it and break out
                     delete edsel_path;
                     return;
@@ -630,17 +957,73 @@ namespace pdftoedn
             //
             // cleanup text painted over by opaque fill regions
             if ( edsel_path->type() == PdfDocPath::FILL &&
-                 cur_gfx.attribs.fill.opacity == 1.0 &&
+                 cur_gfx.attribs->fill.opacity == 1.0 &&
                  edsel_path->is_rectangular() )
             {
                 remove_spans_overlapped_by_region( *edsel_path );
             }
 
-            // all other paths get stored in the graphics list
-            graphics.push_back( edsel_path );
+            // thin paths might be rulings separating blocks of text
+            if (pdftoedn::options.include_text_blocks()) {
+                BoundingBox path_bbox = edsel_path->bounding_box();
+                if (std::min(path_bbox.width(), path_bbox.height()) <= BlockSegmenter::RULING_MAX_THICKNESS) {
+                    rulings.push_back(path_bbox);
+                }
+            }
 
             // update the total graphics bounds
             cur_gfx.bounds.expand( edsel_path->bounding_box() );
+
+            // past the page's point budget, paths are simplified to
+            // one device pixel at the LOD resolution
+            if (max_points > 0 && path_points + edsel_path->num_points() > max_points) {
+                double tolerance = POINTS_PER_INCH / pdftoedn::options.lod_dpi();
+                if (edsel_path->decimate(tolerance)) {
+                    decimated = true;
+                }
+
+                // simplifying alone doesn't bound dense content (e.g.,
+                // scatter plots) so paths that fit in a pixel are kept
+                // once per pixel. The path's bbox is still the one
+                // computed before decimating
+                const BoundingBox& path_bbox = edsel_path->bounding_box();
+                if (path_bbox.width() <= tolerance && path_bbox.height() <= tolerance) {
+                    LODPixel px(static_cast<intmax_t>(std::floor(path_bbox.x_min() / tolerance)),
+                                static_cast<intmax_t>(std::floor(path_bbox.y_min() / tolerance)),
+                                type, eo_flag, cur_gfx.attribs);
+                    if (!lod_pixels.insert(px).second) {
+                        decimated = true;
+                        delete edsel_path;
+                        return;
+                    }
+                }
+
+                // simplified paths get one more budget. Paths that
+                // don't fit in it are dropped so the page's paths
+                // never have more than twice the budget's points
+                if (path_points + edsel_path->num_points() > 2 * max_points) {
+                    decimated = true;
+                    delete edsel_path;
+                    return;
+                }
+            }
+            path_points += edsel_path->num_points();
+
+            // when compacting, append to the previous path if nothing
+            // was painted in between and the result looks the same
+            if (pdftoedn::options.compact_paths() &&
+                last_path && !graphics.empty() && graphics.back() == last_path &&
+                last_path->can_merge(*edsel_path)) {
+                register_painted_gfx( edsel_path->bounding_box() );
+                last_path->merge(*edsel_path);
+                delete edsel_path;
+                return;
+            }
+
+            // all other paths get stored in the graphics list
+            graphics.push_back( edsel_path );
+            register_painted_gfx( edsel_path->bounding_box() );
+            last_path = edsel_path;
         }
     }
 
@@ -649,6 +1032,10 @@ namespace pdftoedn
     // adds an image entry to the list
     void PdfPage::new_image(int resource_id, const BoundingBox& bbox)
     {
+        if (!is_visible(bbox)) {
+            return;
+        }
+
         PdfImage* img = new pdftoedn::PdfImage(resource_id, bbox);
 
         BoundingBox img_bbox(bbox);
@@ -656,10 +1043,11 @@ namespace pdftoedn
             img->set_clip_id( cur_gfx.clip_path() );
 
             // clip the image's bbox
-            img_bbox = img_bbox.clip( clip_paths[cur_gfx.clip_path()]->bounding_box() );
+            img_bbox = img_bbox.clip( cur_gfx.clip_bbox );
         }
 
         graphics.push_back( img );
+        register_painted_gfx( img_bbox );
 
         // update bounds tracking for graphics elements
         cur_gfx.bounds.expand( img_bbox );
@@ -667,15 +1055,81 @@ namespace pdftoedn
 
 
     //
-    // check if a character is within any of the link bboxes
+    // checks a bbox against the page and the current clip region's
+    // bounds
+    bool PdfPage::is_visible(const BoundingBox& bbox) const
+    {
+        if (!inside_page(bbox)) {
+            return false;
+        }
+        if (!cur_gfx.clip_path_set()) {
+            return true;
+        }
+        const BoundingBox& cb = cur_gfx.clip_bbox;
+        return (!clip_region_empty(cb) && bbox.is_inside(cb));
+    }
+
+    //
+    // adds an entry bound by an area (shading, pattern, form) to the
+    // list
+    template <typename T>
+    void PdfPage::add_clipped_gfx(T* gfx)
+    {
+        if (cur_gfx.clip_path_set()) {
+            if (clip_region_empty(cur_gfx.clip_bbox)) {
+                delete gfx;
+                return;
+            }
+
+            gfx->set_clip_id( cur_gfx.clip_path() );
+            gfx->clip_bounds( cur_gfx.clip_bbox );
+        }
+
+        if (!inside_page(gfx->bounding_box())) {
+            delete gfx;
+            return;
+        }
+
+        graphics.push_back( gfx );
+        register_painted_gfx( gfx->bounding_box() );
+
+        cur_gfx.bounds.expand( gfx->bounding_box() );
+    }
+
+    void PdfPage::new_shading(PdfShading* shading)
+    {
+        add_clipped_gfx(shading);
+    }
+
+    void PdfPage::new_pattern_fill(PdfPatternFill* fill)
+    {
+        add_clipped_gfx(fill);
+    }
+
+    void PdfPage::new_form_instance(PdfFormInstance* instance)
+    {
+        add_clipped_gfx(instance);
+    }
+
+
+    //
+    // check if a character is within any of the link bboxes. Only
+    // the links registered in the grid cell containing the center
+    // need to be checked; they're kept in insertion order so the
+    // first match is the lowest link index
     intmax_t PdfPage::inside_link(const BoundingBox& bbox) const
     {
+        if (links.empty()) {
+            return -1;
+        }
+
         Coord bbox_center = bbox.center();
-        auto ii = std::find_if( links.begin(), links.end(),
-                                [&](const PdfAnnotLink* l) { return l->encloses(bbox_center); }
+        const std::vector<uintmax_t>& candidates = link_grid.query(bbox_center);
+        auto ii = std::find_if( candidates.begin(), candidates.end(),
+                                [&](uintmax_t idx) { return links[idx]->encloses(bbox_center); }
                                 );
-        if (ii != links.end()) {
-            return (ii - links.begin());
+        if (ii != candidates.end()) {
+            return *ii;
         }
         return -1;
     }
@@ -707,15 +1161,50 @@ namespace pdftoedn
         resource_h.push( SYMBOL_RES_FONT_LIST,            font_a );
         resource_h.push( SYMBOL_RES_IMAGE_BLOBS,          image_h );
         resource_h.push( SYMBOL_RES_GLYPHS,               glyph_a );
+
+        // tiling pattern tiles, if interpreted
+        util::edn::Vector pattern_a(patterns.size());
+        if (pdftoedn::options.include_tiling_patterns()) {
+            for (const PdfTilingPattern* p : patterns) { pattern_a.push( p ); }
+            resource_h.push( SYMBOL_RES_PATTERNS,         pattern_a );
+        }
+
+        // and forms
+        util::edn::Vector form_a(forms.size());
+        if (pdftoedn::options.cache_forms()) {
+            for (const PdfForm* f : forms) { form_a.push( f ); }
+            resource_h.push( SYMBOL_RES_FORMS,            form_a );
+        }
         return resource_h;
     }
 
+    //
+    // resources, text and graphics only - used for the content of
+    // pattern tiles and forms
+    util::edn::Hash& PdfPage::content_to_edn_hash(util::edn::Hash& content_h) const
+    {
+        util::edn::Vector text_a(text_spans.size());
+        for (const PdfText* t : text_spans) { text_a.push(t); }
+
+        util::edn::Vector gfx_a(clip_paths.size() + graphics.size());
+        for (const PdfDocPath* cp : clip_paths) { gfx_a.push( cp ); }
+        for (const PdfGfxCmd* g : graphics) { gfx_a.push( g ); }
+
+        util::edn::Hash resources;
+        resource_to_edn_hash(resources);
+
+        content_h.push( SYMBOL_RESOURCES,                 resources );
+        content_h.push( SYMBOL_PAGE_TEXT_SPANS,           text_a );
+        content_h.push( SYMBOL_PAGE_GFX_CMDS,             gfx_a );
+        return content_h;
+    }
+
 
     //
     // output the page in EDN
     std::ostream& PdfPage::to_edn(std::ostream& o) const
     {
-        util::edn::Hash page_h(15);
+        util::edn::Hash page_h(16);
         page_h.push( util::version::SYMBOL_DATA_FORMAT_VERSION, util::version::data_format_version() );
         page_h.push( SYMBOL_PAGE_NUMBER,                        number );
         page_h.push( SYMBOL_PAGE_OK,                            !et.errors_reported() );
@@ -724,7 +1213,7 @@ namespace pdftoedn
 
         // an array for the text spans
         util::edn::Vector text_a(text_spans.size());
-        for (const PdfBoxedItem* t : text_spans) { text_a.push(t); }
+        for (const PdfText* t : text_spans) { text_a.push(t); }
 
         // an array for the graphics with clip paths first
         util::edn::Vector gfx_a(clip_paths.size() + graphics.size());
@@ -744,6 +1233,11 @@ namespace pdftoedn
         page_h.push( SYMBOL_PAGE_ROTATION,                rotation );
         page_h.push( SYMBOL_PAGE_HAS_INVISIBLES,          has_invisible_text );
 
+        // paths were simplified to stay within the point budget
+        if (decimated) {
+            page_h.push( SYMBOL_PAGE_DECIMATED,           true );
+        }
+
         // compute the page's bbox based on the text and gfx bounds as
         // we add them to the output to prevent infinite bounds
         // (TESLA-7137)
@@ -761,6 +1255,28 @@ namespace pdftoedn
         page_h.push( SYMBOL_RESOURCES,                    resources );
 
         page_h.push( SYMBOL_PAGE_TEXT_SPANS,              text_a );
+
+        // lines, if assembled, refer to the spans by index
+        util::edn::Vector lines_a(text_lines.size());
+        if (pdftoedn::options.include_text_lines()) {
+            for (const PdfTextLine& l : text_lines) { lines_a.push( &l ); }
+            page_h.push( SYMBOL_PAGE_TEXT_LINES,          lines_a );
+        }
+
+        // same for blocks
+        util::edn::Vector blocks_a(text_blocks.size());
+        if (pdftoedn::options.include_text_blocks()) {
+            for (const PdfTextBlock& b : text_blocks) { blocks_a.push( &b ); }
+            page_h.push( SYMBOL_PAGE_TEXT_BLOCKS,         blocks_a );
+        }
+
+        // and text output once in the document meta
+        util::edn::Vector shared_a(shared_refs.size());
+        if (shared_content) {
+            for (uintmax_t idx : shared_refs) { shared_a.push( idx ); }
+            page_h.push( SYMBOL_PAGE_SHARED_CONTENT,      shared_a );
+        }
+
         page_h.push( SYMBOL_PAGE_GFX_CMDS,                gfx_a );
         page_h.push( SYMBOL_PAGE_LINKS,                   links_a );
 
@@ -783,11 +1299,11 @@ namespace pdftoedn
     // current text state. This ensures a Text entry has been
     // allocated and then the character is pushed into it. NOTE:
     // leading whitespace are ignored
-    bool PdfPage::TextState::push_char(PdfChar* const c)
+    bool PdfPage::TextState::push_char(const PdfChar& c)
     {
         if (!span) {
             // if we're trying to insert a space and there's no span, drop it
-            if (c->is_space()) {
+            if (c.is_space()) {
                 return false;
             }
             span = new PdfText;
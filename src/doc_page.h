@@ -20,7 +20,9 @@
 
 #include <ostream>
 #include <set>
+#include <unordered_set>
 #include <stack>
+#include <tuple>
 #include <list>
 #include <vector>
 
@@ -29,9 +31,16 @@
 #include "base_types.h"
 #include "font.h"
 #include "text.h"
+#include "text_blocks.h"
+#include "shared_content.h"
+#include "path_symbols.h"
 #include "graphics.h"
 #include "image.h"
+#include "shading.h"
+#include "pattern.h"
+#include "form.h"
 #include "pdf_links.h"
+#include "spatial_grid.h"
 
 namespace pdftoedn
 {
@@ -44,8 +53,19 @@ namespace pdftoedn
         // constructor / destructor
         PdfPage(uintmax_t page_number, double page_width, double page_height, intmax_t page_rotation) :
             number(page_number), bbox(0, 0, page_width, page_height), rotation(page_rotation),
-            has_invisible_text(false)
-        {}
+            has_invisible_text(false),
+            path_points(0), decimated(false),
+            last_text_attribs(NULL), last_gfx_attribs(NULL),
+            paint_seq(0),
+            last_path(NULL),
+            shared_content(NULL),
+            path_symbols(NULL),
+            span_grid(bbox, GRID_CELL_SIZE),
+            gfx_grid(bbox, GRID_CELL_SIZE),
+            link_grid(bbox, GRID_CELL_SIZE)
+        {
+            cur_gfx.attribs = register_gfx_attribs(GfxAttribs());
+        }
         virtual ~PdfPage();
 
         // accessors
@@ -57,12 +77,31 @@ namespace pdftoedn
         // adds an entry to the color table if it doesn't exist;
         // returns the index in the table
         uintmax_t register_color(color_comp_t r, color_comp_t g, color_comp_t b);
+        // same for text & graphics attributes. Characters and paths
+        // point to the single copy stored in the page's table
+        const TextAttribs* register_text_attribs(const TextAttribs& attribs);
+        const GfxAttribs* register_gfx_attribs(const GfxAttribs& attribs);
 
         // path ops --
         // creates a path, inserts it into the path list and returns a
         // reference to it
         void add_path(GfxState* state, PdfDocPath::Type type, PdfDocPath::EvenOddRule eo_flag);
 
+        // smooth shadings, pattern fills and form placements - the
+        // page takes ownership
+        void new_shading(PdfShading* shading);
+        void new_pattern_fill(PdfPatternFill* fill);
+        void new_form_instance(PdfFormInstance* instance);
+        // tiling patterns are owned by the output device - the page
+        // only lists the ones it outputs first
+        void new_pattern(const PdfTilingPattern* pattern) { patterns.push_back(pattern); }
+        // same for forms
+        void new_form(const PdfForm* form) { forms.push_back(form); }
+
+        // can anything painted in the bbox be seen? False if it is
+        // outside the page or the current clip
+        bool is_visible(const BoundingBox& bbox) const;
+
         // image blob manipulations
         bool image_is_cached(intmax_t resource_id) const;
         bool inlined_image_is_cached(const std::string& md5, intmax_t& res_id) const;
@@ -82,6 +121,9 @@ namespace pdftoedn
         void new_character(double x, double y, double width, double height, const PdfTM& ctm,
                            const TextMetrics& metrics, uintmax_t unicode_c, intmax_t glyph_idx,
                            bool invisible);
+        // glyphs are owned by the font engine - the page only lists
+        // the ones it outputs first
+        void new_glyph(const PdfGlyph* glyph) { glyphs.push_back(glyph); }
 
         // graphics-related methods --
         //
@@ -89,25 +131,29 @@ namespace pdftoedn
         void pop_gfx_state();
 
         // update_line_dash: pass by copy to invoke vector= w/ move
-        void update_line_dash(std::vector<double> l_dash) { cur_gfx.attribs.line_dash = l_dash; }
-        void clear_line_dash() { cur_gfx.attribs.line_dash.clear(); }
-        void update_line_join(int8_t line_join) { cur_gfx.attribs.line_join = line_join; }
-        void update_line_cap(int8_t line_cap) { cur_gfx.attribs.line_cap = line_cap; }
-        void update_miter_limit(double miter_limit) { cur_gfx.attribs.miter_limit = miter_limit; }
-        void update_line_width(double line_width) { cur_gfx.attribs.line_width = line_width; }
+        void update_line_dash(std::vector<double> l_dash) {
+            update_gfx_attribs([&](GfxAttribs& a) { a.line_dash.swap(l_dash); });
+        }
+        void clear_line_dash() { update_gfx_attribs([](GfxAttribs& a) { a.line_dash.clear(); }); }
+        void update_line_join(int8_t line_join) { update_gfx_attribs([=](GfxAttribs& a) { a.line_join = line_join; }); }
+        void update_line_cap(int8_t line_cap) { update_gfx_attribs([=](GfxAttribs& a) { a.line_cap = line_cap; }); }
+        void update_miter_limit(double miter_limit) { update_gfx_attribs([=](GfxAttribs& a) { a.miter_limit = miter_limit; }); }
+        void update_line_width(double line_width) { update_gfx_attribs([=](GfxAttribs& a) { a.line_width = line_width; }); }
         void update_stroke_color(color_comp_t r, color_comp_t g, color_comp_t b) {
-            cur_gfx.attribs.stroke.color_idx = register_color(r, g, b);
+            uintmax_t color_idx = register_color(r, g, b);
+            update_gfx_attribs([=](GfxAttribs& a) { a.stroke.color_idx = color_idx; });
         }
-        void update_stroke_opacity(double opacity) { cur_gfx.attribs.stroke.opacity = opacity; }
-        void update_stroke_overprint(bool overprint) { cur_gfx.attribs.stroke.overprint = overprint; }
+        void update_stroke_opacity(double opacity) { update_gfx_attribs([=](GfxAttribs& a) { a.stroke.opacity = opacity; }); }
+        void update_stroke_overprint(bool overprint) { update_gfx_attribs([=](GfxAttribs& a) { a.stroke.overprint = overprint; }); }
 
         void update_fill_color(color_comp_t r, color_comp_t g, color_comp_t b) {
-            cur_gfx.attribs.fill.color_idx = register_color(r, g, b);
+            uintmax_t color_idx = register_color(r, g, b);
+            update_gfx_attribs([=](GfxAttribs& a) { a.fill.color_idx = color_idx; });
         }
-        void update_fill_opacity(double opacity) { cur_gfx.attribs.fill.opacity = opacity; }
-        void update_fill_overprint(bool overprint) { cur_gfx.attribs.fill.overprint = overprint; }
-        void update_overprint_mode(uint8_t mode) { cur_gfx.attribs.overprint_mode = mode; }
-        void update_blend_mode(uint8_t blend_mode) { cur_gfx.attribs.blend_mode = blend_mode; }
+        void update_fill_opacity(double opacity) { update_gfx_attribs([=](GfxAttribs& a) { a.fill.opacity = opacity; }); }
+        void update_fill_overprint(bool overprint) { update_gfx_attribs([=](GfxAttribs& a) { a.fill.overprint = overprint; }); }
+        void update_overprint_mode(uint8_t mode) { update_gfx_attribs([=](GfxAttribs& a) { a.overprint_mode = mode; }); }
+        void update_blend_mode(uint8_t blend_mode) { update_gfx_attribs([=](GfxAttribs& a) { a.blend_mode = blend_mode; }); }
 
         // images --
         //
@@ -116,11 +162,27 @@ namespace pdftoedn
 
         // links --
         void new_annot_link(pdftoedn::PdfAnnotLink* const annot_link) {
+            link_grid.insert(links.size(), annot_link->bounding_box());
             links.push_back(annot_link);
         }
 
         void finalize();
 
+        // text repeated across pages. The page is scanned for it
+        // after a pre-pass and, once set, matching spans are replaced
+        // by a reference when the page is finalized
+        void collect_shared_content(SharedContent& shared) const;
+        void set_shared_content(const SharedContent* shared) { shared_content = shared; }
+
+        // same for path geometry repeated in the document. Matching
+        // paths are output as a reference to the symbol
+        void collect_path_symbols(PathSymbols& symbols) const;
+        void set_path_symbols(const PathSymbols* symbols) { path_symbols = symbols; }
+
+        // EDN output of the page's resources, text spans and graphics
+        // into the given hash
+        util::edn::Hash& content_to_edn_hash(util::edn::Hash& h) const;
+
         virtual std::ostream& to_edn(std::ostream& o) const;
 
         static const pdftoedn::Symbol SYMBOL_PAGE_TEXT_SPANS;
@@ -141,6 +203,7 @@ namespace pdftoedn
 
             bool is_equivalent_to(const PdfFont& font) const;
             void log_font_issues() const;
+            const PdfFont* font() const { return *(matching_doc_fonts.begin()); }
 
             virtual std::ostream& to_edn(std::ostream& o) const;
 
@@ -154,48 +217,113 @@ namespace pdftoedn
         intmax_t rotation;
         bool has_invisible_text;
 
+        // points in the stored paths, checked against the page's
+        // budget; set if paths had to be simplified
+        uintmax_t path_points;
+        bool decimated;
+        // cells of the LOD grid already holding a sub-pixel path, by
+        // path type, fill rule and attribs
+        typedef std::tuple<intmax_t, intmax_t, int, int, const GfxAttribs*> LODPixel;
+        std::set<LODPixel> lod_pixels;
+
         // resources
         std::stack<const PdfFont*> pending_font;
         std::vector<PageFont *> fonts;
         std::vector<pdftoedn::RGBColor *> colors;
         std::set<pdftoedn::ImageData*, pdftoedn::ImageData::lt> images;
-        std::vector<pdftoedn::PdfGlyph *> glyphs;
+        std::vector<const pdftoedn::PdfGlyph *> glyphs;
+        std::vector<const pdftoedn::PdfTilingPattern *> patterns;
+        std::vector<const pdftoedn::PdfForm *> forms;
+        std::unordered_set<pdftoedn::TextAttribs, pdftoedn::TextAttribs::hash> text_attribs_table;
+        std::unordered_set<pdftoedn::GfxAttribs, pdftoedn::GfxAttribs::hash, pdftoedn::GfxAttribs::eq> gfx_attribs_table;
+        const pdftoedn::TextAttribs* last_text_attribs;
+        const pdftoedn::GfxAttribs* last_gfx_attribs;
 
         // data
-        std::multiset<pdftoedn::PdfBoxedItem *, pdftoedn::PdfBoxedItem::lt> text_spans;
+        // spans are collected in paint order and sorted once the page
+        // is finalized. Removed spans leave a NULL entry until then
+        std::vector<pdftoedn::PdfText *> text_spans;
+        std::vector<pdftoedn::PdfTextLine> text_lines;
+        std::vector<pdftoedn::PdfTextBlock> text_blocks;
+        std::vector<pdftoedn::BoundingBox> rulings;
         std::list<pdftoedn::PdfGfxCmd *> graphics;
         std::vector<pdftoedn::PdfDocPath *> clip_paths;
         std::vector<pdftoedn::PdfAnnotLink *> links;
 
+        // spans and graphics are numbered in the order they're
+        // painted. The bbox of each stored graphic is kept with its
+        // number to tell what was painted between two spans
+        uintmax_t paint_seq;
+        std::vector< std::pair<uintmax_t, BoundingBox> > painted_gfx;
+
+        // last stored path, if nothing was painted after it, so
+        // compacted paths can be merged into it
+        PdfDocPath* last_path;
+
+        // indices of the document's shared content found on the page
+        const SharedContent* shared_content;
+        std::vector<uintmax_t> shared_refs;
+
+        // the document's repeated path geometry
+        const PathSymbols* path_symbols;
+
+        // lookup of stored spans, graphics (index in painted_gfx) and
+        // link indices by location
+        static const double GRID_CELL_SIZE;
+        SpatialGrid<uintmax_t> span_grid;
+        SpatialGrid<uintmax_t> gfx_grid;
+        SpatialGrid<uintmax_t> link_grid;
+
         // transient state as text is collected
         struct TextState {
-            TextState() : span(NULL) { }
+            TextState() : span(NULL), clip_bbox(0, 0, 0, 0) { }
             ~TextState() { delete span; }
 
             pdftoedn::TextAttribs attribs;
             pdftoedn::PdfText *span;
             pdftoedn::Bounds bounds;
+            // clip region when the span was started
+            pdftoedn::BoundingBox clip_bbox;
 
             // helpers
-            bool push_char(pdftoedn::PdfChar* const c);
+            bool push_char(const pdftoedn::PdfChar& c);
             pdftoedn::PdfText* pop_text();
         } cur_text;
 
         // transient state of gfx as collected
         struct GraphicsState {
-            GraphicsState() { }
+            GraphicsState() : attribs(NULL), clip_bbox(0, 0, 0, 0) { }
 
-            bool clip_path_set() const { return (attribs.clip_idx != -1); }
-            intmax_t clip_path() const { return attribs.clip_idx; }
+            bool clip_path_set() const { return (attribs->clip_idx != -1); }
+            intmax_t clip_path() const { return attribs->clip_idx; }
 
             pdftoedn::Bounds bounds;
-            GfxAttribs attribs;
+            // points into the page's attribs table. Entries are shared
+            // so they are never modified - see update_gfx_attribs()
+            const GfxAttribs* attribs;
+
+            // bounds of the intersection of all clip paths in effect
+            // (the output only refers to the innermost one). Valid if
+            // clip_path_set()
+            pdftoedn::BoundingBox clip_bbox;
 
             // track the current gfx state as it is pushed / popped in
             // the PDF
-            std::stack<GfxAttribs> attribs_stack;
+            std::stack<const GfxAttribs*> attribs_stack;
+            std::stack<pdftoedn::BoundingBox> clip_bbox_stack;
         } cur_gfx;
 
+        // copy-on-write update of the current gfx attribs. Only
+        // registers a new entry if the attribs actually change
+        template <typename F>
+        void update_gfx_attribs(F modify) {
+            GfxAttribs a(*cur_gfx.attribs);
+            modify(a);
+            if (!GfxAttribs::eq()(a, *cur_gfx.attribs)) {
+                cur_gfx.attribs = register_gfx_attribs(a);
+            }
+        }
+
         // helpers
         bool in_pending_list(const PdfFont* f) const;
         intmax_t get_color_index(color_comp_t r, color_comp_t g, color_comp_t b) const;
@@ -203,10 +331,23 @@ namespace pdftoedn
         intmax_t cur_font_index() const { return cur_text.attribs.font_idx; }
 
         bool inside_page(const BoundingBox& bbox) const { return bbox.is_inside( this->bbox ); }
+        // nothing shows through a clip region with no area (e.g.,
+        // nested clips that don't overlap)
+        static bool clip_region_empty(const BoundingBox& cb) { return (cb.width() <= 0 || cb.height() <= 0); }
         intmax_t inside_link(const BoundingBox& bbox) const;
         bool insert_pending_span();
+        void erase_span(uintmax_t span_idx);
+        void find_span_candidates(const BoundingBox& bbox, std::vector<uintmax_t>& candidates) const;
+        void sort_text_spans();
         void remove_spans_overlapped_by_span(const PdfText& span);
+        void register_painted_gfx(const BoundingBox& gfx_bbox);
+        template <typename T>
+        void add_clipped_gfx(T* gfx);
+        bool painted_over_since(const BoundingBox& bbox, uintmax_t seq) const;
         void remove_spans_overlapped_by_region(const PdfPath& region);
+        bool shared_content_key(const PdfText& span, SharedContent::Key& key) const;
+        void remove_shared_spans();
+        void use_path_symbols();
         intmax_t find_clip_path(PdfDocPath* const path);
 
         // mark end of text object - triggers pushing of any pending spans
@@ -70,10 +70,15 @@ namespace pdftoedn {
                      const std::string& edn_filename,
                      const std::string& fontmap,
                      const Flags& f,
-                     intmax_t pg_num) :
+                     intmax_t pg_num,
+                     uintmax_t x_delta_units,
+                     uintmax_t max_path_points,
+                     uintmax_t lod_dpi) :
         src_pdf_filename(pdf_filename),
         src_pdf_owner_password(pdf_owner_password), src_pdf_user_password(pdf_user_password),
-        out_edn_filename(edn_filename), flags(f), page_num(pg_num)
+        out_edn_filename(edn_filename), flags(f), page_num(pg_num),
+        x_deltas_scale(x_delta_units),
+        max_page_path_points(max_path_points), lod_resolution(lod_dpi)
     {
         namespace fs = boost::filesystem;
         fs::path file_path = src_pdf_filename;
@@ -259,7 +264,14 @@ namespace pdftoedn {
         }
 
         if (opt.page_num != -1) {
-            o << "   req'd page number: " <<opt.page_num;
+            o << "   req'd page number: " <<opt.page_num << std::endl;
+        }
+        if (opt.x_deltas_scale > 0) {
+            o << "   x delta units:     1/" << opt.x_deltas_scale << " pt" << std::endl;
+        }
+        if (opt.max_page_path_points > 0) {
+            o << "   max path points:   " << opt.max_page_path_points
+              << " per page (LOD at " << opt.lod_resolution << " dpi)" << std::endl;
         }
 
         std::list<std::string> opts;
@@ -281,6 +293,24 @@ namespace pdftoedn {
             opts.push_back("font_preprocess");
         if (opt.flags.force_output_write)
             opts.push_back("force_output_write");
+        if (opt.flags.include_text_lines)
+            opts.push_back("text_lines");
+        if (opt.flags.include_text_blocks)
+            opts.push_back("text_blocks");
+        if (opt.flags.dedupe_shared_content)
+            opts.push_back("shared_content");
+        if (opt.flags.compact_paths)
+            opts.push_back("compact_paths");
+        if (opt.flags.native_shading)
+            opts.push_back("gradients");
+        if (opt.flags.include_tiling_patterns)
+            opts.push_back("tiling_patterns");
+        if (opt.flags.cache_forms)
+            opts.push_back("forms");
+        if (opt.flags.path_symbols)
+            opts.push_back("symbols");
+        if (opt.flags.cull_chars)
+            opts.push_back("cull_chars");
 
         if (!opts.empty()) {
             o << "   Flags:             ";
@@ -36,21 +36,43 @@ namespace pdftoedn {
             bool libpng_use_best_compression;
             bool force_font_preprocess;
             bool force_output_write;
+            bool include_text_lines;
+            bool include_text_blocks;
+            bool dedupe_shared_content;
+            bool compact_paths;
+            bool native_shading;
+            bool include_tiling_patterns;
+            bool cache_forms;
+            bool path_symbols;
+            bool cull_chars;
         };
 
-        Options() : page_num(-1) {}
+        // resolution at which paths are simplified once a page's
+        // point budget is exceeded
+        static const uintmax_t DEFAULT_LOD_DPI = 72;
+
+        Options() : page_num(-1), x_deltas_scale(0), max_page_path_points(0), lod_resolution(DEFAULT_LOD_DPI) {}
         Options(const std::string& pdf_filename,
                 const std::string& pdf_owner_password,
                 const std::string& pdf_user_password,
                 const std::string& edn_filename,
                 const std::string& font_map,
                 const Flags& f,
-                intmax_t pg_num);
+                intmax_t pg_num,
+                uintmax_t x_delta_units = 0,
+                uintmax_t max_path_points = 0,
+                uintmax_t lod_dpi = DEFAULT_LOD_DPI);
 
         const std::string& pdf_filename() const  { return src_pdf_filename; }
         const std::string& edn_filename() const  { return out_edn_filename; }
         const std::string& outputdir() const     { return output_path; }
         intmax_t page_number() const             { return page_num; }
+        // if > 0, text x positions are output as deltas in 1/n pt
+        uintmax_t x_delta_scale() const          { return x_deltas_scale; }
+        // if > 0, paths are simplified at lod_dpi once a page's
+        // paths have this many points
+        uintmax_t max_path_points_per_page() const { return max_page_path_points; }
+        uintmax_t lod_dpi() const                { return lod_resolution; }
 
         const std::string& pdf_owner_password() const { return src_pdf_owner_password; }
         const std::string& pdf_user_password() const  { return src_pdf_user_password; }
@@ -67,6 +89,15 @@ namespace pdftoedn {
         bool include_debug_info() const          { return flags.include_debug_info; }
         bool force_pre_process_fonts() const     { return flags.force_font_preprocess; }
         bool force_output_write() const          { return flags.force_output_write; }
+        bool include_text_lines() const          { return flags.include_text_lines; }
+        bool include_text_blocks() const         { return flags.include_text_blocks; }
+        bool dedupe_shared_content() const       { return flags.dedupe_shared_content; }
+        bool compact_paths() const               { return flags.compact_paths; }
+        bool native_shading() const              { return flags.native_shading; }
+        bool include_tiling_patterns() const     { return flags.include_tiling_patterns; }
+        bool cache_forms() const                 { return flags.cache_forms; }
+        bool path_symbols() const                { return flags.path_symbols; }
+        bool cull_chars() const                  { return flags.cull_chars; }
 
         friend std::ostream& operator<<(std::ostream& o, const Options& opt);
 
@@ -78,6 +109,9 @@ namespace pdftoedn {
         std::string font_map;
         Flags flags;
         intmax_t page_num;
+        uintmax_t x_deltas_scale;
+        uintmax_t max_page_path_points;
+        uintmax_t lod_resolution;
         std::string output_path;
         std::string resource_dir;
         std::string doc_base_name;
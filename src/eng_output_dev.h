@@ -27,6 +27,8 @@
 namespace pdftoedn
 {
     class PdfPage;
+    class SharedContent;
+    class PathSymbols;
 
     //------------------------------------------------------------------------
     // pdftoedn::EngOutputDev - base class for all our output devices
@@ -34,7 +36,7 @@ namespace pdftoedn
     class EngOutputDev : public ::OutputDev {
     public:
         EngOutputDev(Catalog* doc_cat) :
-            catalog(doc_cat), pg_data(NULL) { }
+            catalog(doc_cat), pg_data(NULL), shared_content(NULL), path_symbols(NULL) { }
         virtual ~EngOutputDev();
 
         // skip anything larger than 10 inches
@@ -50,9 +52,20 @@ namespace pdftoedn
         // called to process a page
         const PdfPage* page_data() const { return pg_data; }
 
+        // text repeated across pages, found in a pre-pass
+        void set_shared_content(const SharedContent* shared) { shared_content = shared; }
+        // and path geometry repeated in the document
+        void set_path_symbols(const PathSymbols* symbols) { path_symbols = symbols; }
+
+        // resources defined on the first page that uses them must be
+        // output again after a pre-pass
+        virtual void reset_resource_output() { }
+
     protected:
         Catalog* catalog;
         pdftoedn::PdfPage* pg_data;
+        const SharedContent* shared_content;
+        const PathSymbols* path_symbols;
 
         void process_page_links(int page_num);
         void create_annot_link(AnnotLink *link);
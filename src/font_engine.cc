@@ -40,6 +40,7 @@ namespace pdftoedn
     FontEngine::~FontEngine()
     {
         util::delete_ptr_map_elems(fonts);
+        util::delete_ptr_map_elems(glyphs);
         if (ft_lib) {
             FT_Done_FreeType(ft_lib);
         }
@@ -49,7 +50,7 @@ namespace pdftoedn
     // init freetype
     FontEngine::FontEngine(XRef *doc_xref) :
         xref(doc_xref), has_font_warnings(false),
-        ft_lib(NULL), cur_doc_font(NULL)
+        ft_lib(NULL), cur_doc_font(NULL), num_glyphs(0)
     {
         FT_Library ftl;
 
@@ -302,4 +303,40 @@ namespace pdftoedn
         return CODE_REMAP_ERROR;
     }
 
+
+    //
+    // look up or build the outline for a code the current font can't
+    // map. Failed lookups are cached too so we don't retry them
+    const PdfGlyph* FontEngine::get_glyph(CharCode code, bool& first_use)
+    {
+        first_use = false;
+
+        if (!cur_doc_font) {
+            return NULL;
+        }
+
+        const FontSource* src = cur_doc_font->src();
+        GlyphKey key( (!src->font_blob_md5().empty() ? src->font_blob_md5() : src->font_name()), code );
+
+        PdfGlyph* g;
+        std::map<GlyphKey, PdfGlyph*>::const_iterator gi = glyphs.find(key);
+        if (gi != glyphs.end()) {
+            g = gi->second;
+        } else {
+            g = new PdfGlyph(num_glyphs);
+            if (!src->get_glyph_path(code, *g) || g->length() == 0) {
+                delete g;
+                g = NULL;
+            } else {
+                num_glyphs++;
+            }
+            glyphs[key] = g;
+        }
+
+        if (g) {
+            first_use = output_glyphs.insert(g).second;
+        }
+        return g;
+    }
+
 } // namespace
@@ -48,6 +48,7 @@ namespace pdftoedn
 {
     class PdfFont;
     class PdfPath;
+    class PdfGlyph;
 
     typedef std::map<PdfRef, pdftoedn::PdfFont *> FontList;
     typedef std::pair<const pdftoedn::PdfRef, pdftoedn::PdfFont *> FontListEntry;
@@ -89,13 +90,28 @@ namespace pdftoedn
         };
         eCodeRemapStatus get_code_unicode(CharCode code, Unicode* const u, uintmax_t& unicode);
 
+        // outline of an unmapped code in the current font. Glyphs are
+        // cached for the whole document, keyed by the font's data so
+        // fonts embedded multiple times share them; first_use is set
+        // the first time one is returned so the page can output it.
+        // Returns NULL if there's no outline to draw
+        const pdftoedn::PdfGlyph* get_glyph(CharCode code, bool& first_use);
+        // forget which glyphs were output (e.g., after a pre-pass)
+        void reset_glyph_output() { output_glyphs.clear(); }
+
     private:
+        typedef std::pair<std::string, CharCode> GlyphKey;
+
+
         XRef *xref; // PDF document ref for object lookup
         bool has_font_warnings;
         FontList fonts;
         std::set<double> font_sizes;
         FT_Library ft_lib;
         pdftoedn::PdfFont* cur_doc_font;
+        std::map<GlyphKey, pdftoedn::PdfGlyph *> glyphs;
+        std::set<const pdftoedn::PdfGlyph *> output_glyphs;
+        uintmax_t num_glyphs;
 
         pdftoedn::PdfFont* find_font(GfxFont* gfx_font) const;
         static std::string sanitize_font_name(const std::string& name);
@@ -0,0 +1,86 @@
+//
+// Copyright 2016-2017 Ed Porras
+//
+// This file is part of pdftoedn.
+//
+// pdftoedn is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// pdftoedn is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with pdftoedn.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "form.h"
+#include "doc_page.h"
+#include "shading.h"
+#include "util_edn.h"
+
+namespace pdftoedn
+{
+    const pdftoedn::Symbol PdfForm::SYMBOL_ID                        = "id";
+
+    const pdftoedn::Symbol PdfFormInstance::SYMBOL_TYPE_FORM         = "form";
+    const pdftoedn::Symbol PdfFormInstance::SYMBOL_FORM_ID           = "form_id";
+
+    // =============================================
+    // PdfForm
+    //
+    PdfForm::~PdfForm()
+    {
+        delete content;
+    }
+
+    //
+    // {:id n, :bbox [...], :resources {...}, :text_spans [...],
+    // :graphics [...]}
+    std::ostream& PdfForm::to_edn(std::ostream& o) const
+    {
+        util::edn::Hash form_h(5);
+        form_h.push( SYMBOL_ID,                      idx );
+        form_h.push( BoundingBox::SYMBOL,            bbox );
+
+        content->content_to_edn_hash(form_h);
+
+        o << form_h;
+        return o;
+    }
+
+
+    // =============================================
+    // PdfFormInstance
+    //
+
+    //
+    // {:type :form, :bbox [...], :form_id n, :transform [a b c d e f]}
+    std::ostream& PdfFormInstance::to_edn(std::ostream& o) const
+    {
+        util::edn::Hash form_h(5);
+        form_h.push( SYMBOL_TYPE,                    cmd );
+        form_h.push( BoundingBox::SYMBOL,            bbox );
+        form_h.push( SYMBOL_FORM_ID,                 form_idx );
+
+        util::edn::Vector tm_a(6);
+        tm_a.push( tm.a() );
+        tm_a.push( tm.b() );
+        tm_a.push( tm.c() );
+        tm_a.push( tm.d() );
+        tm_a.push( tm.e() );
+        tm_a.push( tm.f() );
+        form_h.push( PdfShading::SYMBOL_TRANSFORM,   tm_a );
+
+        if (clip_path_id != -1) {
+            form_h.push( PdfDocPath::SYMBOL_CLIP_TO, clip_path_id );
+        }
+
+        o << form_h;
+        return o;
+    }
+
+} // namespace
@@ -0,0 +1,95 @@
+//
+// Copyright 2016-2017 Ed Porras
+//
+// This file is part of pdftoedn.
+//
+// pdftoedn is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// pdftoedn is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with pdftoedn.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include <ostream>
+
+#include "base_types.h"
+#include "graphics.h"
+
+namespace pdftoedn
+{
+    class PdfPage;
+
+    // -------------------------------------------------------
+    // Form XObject interpreted once. The content is collected in its
+    // own page-like container, y-down like a page with the origin at
+    // the form's bbox top-left corner. Owns the content
+    //
+    class PdfForm : public gemable {
+    public:
+        static const pdftoedn::Symbol SYMBOL_ID;
+
+        // form_tm maps the content to the form's user space (the
+        // flip, the bbox offset and the form's matrix)
+        PdfForm(uintmax_t form_id, double form_width, double form_height,
+                const PdfTM& form_tm, PdfPage* form_content) :
+            idx(form_id), bbox(0, 0, form_width, form_height),
+            tm(form_tm), content(form_content)
+        { }
+        virtual ~PdfForm();
+
+        uintmax_t id() const { return idx; }
+        const BoundingBox& bounding_box() const { return bbox; }
+        const PdfTM& form_tm() const { return tm; }
+
+        virtual std::ostream& to_edn(std::ostream& o) const;
+
+    private:
+        uintmax_t idx;
+        BoundingBox bbox;
+        PdfTM tm;
+        PdfPage* content;
+
+        // prohibit
+        PdfForm(const PdfForm&);
+        PdfForm& operator=(const PdfForm&);
+    };
+
+
+    // -------------------------------------------------------
+    // a placement of a form. Refers to it by id; the transform maps
+    // the form's content to the page
+    //
+    class PdfFormInstance : public PdfGfxCmd {
+    public:
+        static const pdftoedn::Symbol SYMBOL_TYPE_FORM;
+        static const pdftoedn::Symbol SYMBOL_FORM_ID;
+
+        PdfFormInstance(uintmax_t form_id, const PdfTM& form_tm, const BoundingBox& b) :
+            PdfGfxCmd(SYMBOL_TYPE_FORM),
+            form_idx(form_id), tm(form_tm), bbox(b),
+            clip_path_id(-1)
+        { }
+
+        void set_clip_id(intmax_t clip_id) { clip_path_id = clip_id; }
+        void clip_bounds(const BoundingBox& clip_bbox) { bbox = bbox.clip(clip_bbox); }
+        const BoundingBox& bounding_box() const { return bbox; }
+
+        virtual std::ostream& to_edn(std::ostream& o) const;
+
+    private:
+        uintmax_t form_idx;
+        PdfTM tm;
+        BoundingBox bbox;
+        intmax_t clip_path_id;
+    };
+
+} // namespace
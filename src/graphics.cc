@@ -17,7 +17,9 @@
 // along with pdftoedn.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <ostream>
-#include <list>
+#include <cmath>
+
+#include <boost/functional/hash.hpp>
 
 #include "graphics.h"
 #include "util.h"
@@ -25,53 +27,6 @@
 
 namespace pdftoedn
 {
-    // -------------------------------------------------------
-    // move_to
-    //
-    struct PdfMoveTo : public PdfSubPathCmd {
-        static const pdftoedn::Symbol SYMBOL_COMMAND;
-
-        PdfMoveTo(const Coord& c) :
-            PdfSubPathCmd(SYMBOL_COMMAND, c)
-        { }
-    };
-
-    // -------------------------------------------------------
-    // curve_to
-    //
-    struct PdfCurveTo : public PdfSubPathCmd {
-        static const pdftoedn::Symbol SYMBOL_COMMAND;
-
-        PdfCurveTo(const Coord& c1, const Coord& c2, const Coord& c3) :
-            PdfSubPathCmd(SYMBOL_COMMAND, c1, c2, c3)
-        { }
-
-        virtual bool is_curved() const { return true; }
-     };
-
-    // -------------------------------------------------------
-    // line_to
-    //
-    struct PdfLineTo : public PdfSubPathCmd {
-        static const pdftoedn::Symbol SYMBOL_COMMAND;
-
-        PdfLineTo(const Coord& c) :
-            PdfSubPathCmd(SYMBOL_COMMAND, c)
-        { }
-    };
-
-    // -------------------------------------------------------
-    // close_path
-    //
-    struct PdfClosePath : public PdfSubPathCmd {
-        static const pdftoedn::Symbol SYMBOL_COMMAND;
-
-        PdfClosePath() :
-            PdfSubPathCmd(SYMBOL_COMMAND)
-        { }
-    };
-
-
     // const statics
     const pdftoedn::Symbol PdfGfxCmd::SYMBOL_TYPE               = "type";
 
@@ -103,11 +58,14 @@ namespace pdftoedn
     const pdftoedn::Symbol PdfDocPath::SYMBOL_EVEN_ODD          = "even_odd";
     const pdftoedn::Symbol PdfDocPath::SYMBOL_ID                = "id";
     const pdftoedn::Symbol PdfDocPath::SYMBOL_CLIP_TO           = "clip_path";
+    const pdftoedn::Symbol PdfDocPath::SYMBOL_SYMBOL_IDX        = "symbol";
+    const pdftoedn::Symbol PdfDocPath::SYMBOL_OFFSET            = "offset";
+
+    // indexed by PdfPath::Op
+    static const pdftoedn::Symbol SYMBOL_PATH_COMMANDS[]        = { "move_to", "line_to", "curve_to", "close_path", "rect" };
+    static const uint8_t PATH_COMMAND_POINTS[]                  = { 1, 1, 3, 0, 2 };
 
-    const pdftoedn::Symbol PdfMoveTo::SYMBOL_COMMAND            = "move_to";
-    const pdftoedn::Symbol PdfCurveTo::SYMBOL_COMMAND           = "curve_to";
-    const pdftoedn::Symbol PdfLineTo::SYMBOL_COMMAND            = "line_to";
-    const pdftoedn::Symbol PdfClosePath::SYMBOL_COMMAND         = "close_path";
+    const double PdfPath::COLLINEAR_TOLERANCE                   = 1e-9;
 
 
     // -------------------------------------------------------
@@ -126,61 +84,6 @@ namespace pdftoedn
         return o;
     }
 
-    // -------------------------------------------------------
-    // coordinate-op commands
-    //
-
-    //
-    //
-    PdfSubPathCmd::PdfSubPathCmd(const pdftoedn::Symbol& cmd_name,
-                                 const Coord& c1,
-                                 const Coord& c2,
-                                 const Coord& c3) :
-        PdfGfxCmd(cmd_name)
-    {
-        coords.push_back(c1);
-        coords.push_back(c2);
-        coords.push_back(c3);
-    }
-
-    //
-    // returns the last coordinate added
-    bool PdfSubPathCmd::get_cur_pt(Coord& c) const
-    {
-        if (coords.empty()) {
-            return false;
-        }
-
-        c = coords.back();
-        return true;
-    }
-
-    //
-    // command EDN output
-    std::ostream& PdfSubPathCmd::to_edn(std::ostream& o) const
-    {
-        util::edn::Vector cmds_v(2);
-        PdfGfxCmd::to_edn_vector(cmds_v);
-
-        if (coords.size() == 1) {
-            // if there's only a single coordinate, store it on its
-            // own
-            cmds_v.push( &coords.back() );
-        }
-        else if (coords.size() > 1) {
-            // there are more than one (or, zero, I guess but that
-            // would be odd). Wrap the coords in an array
-            util::edn::Vector coords_a(coords.size());
-            for ( const Coord& c : coords ) {
-                coords_a.push( c );
-            }
-            cmds_v.push( coords_a );
-        }
-        o << cmds_v;
-        return o;
-    }
-
-
     // -------------------------------------------------------
     // gfx attributes helper class
     //
@@ -197,6 +100,36 @@ namespace pdftoedn
                 );
     }
 
+    //
+    // hash & exact comparison of all fields for interning
+    size_t GfxAttribs::hash::operator()(const GfxAttribs& a) const
+    {
+        size_t seed = 0;
+        boost::hash_combine(seed, a.stroke.color_idx);
+        boost::hash_combine(seed, a.stroke.opacity);
+        boost::hash_combine(seed, a.stroke.overprint);
+        boost::hash_combine(seed, a.fill.color_idx);
+        boost::hash_combine(seed, a.fill.opacity);
+        boost::hash_combine(seed, a.fill.overprint);
+        boost::hash_combine(seed, a.line_dash);
+        boost::hash_combine(seed, a.line_width);
+        boost::hash_combine(seed, a.miter_limit);
+        boost::hash_combine(seed, a.line_cap);
+        boost::hash_combine(seed, a.line_join);
+        boost::hash_combine(seed, a.blend_mode);
+        boost::hash_combine(seed, a.overprint_mode);
+        boost::hash_combine(seed, a.clip_idx);
+        return seed;
+    }
+
+    bool GfxAttribs::eq::operator()(const GfxAttribs& a1, const GfxAttribs& a2) const
+    {
+        return ( a1.equals(a2) &&
+                 (a1.line_dash == a2.line_dash) &&
+                 (a1.overprint_mode == a2.overprint_mode) &&
+                 (a1.clip_idx == a2.clip_idx) );
+    }
+
     //
     // debug
     std::ostream& GfxAttribs::StrokeFill::dump(std::ostream& o) const {
@@ -231,45 +164,54 @@ namespace pdftoedn
     // -------------------------------------------------------
     // path building
     //
-    PdfPath::~PdfPath()
-    {
-        util::delete_ptr_container_elems(cmds);
-    }
 
     //
     // compare if two paths are the same
     bool PdfPath::equals(const PdfPath& p2) const
     {
-        if (cmds.size() != p2.cmds.size()) {
+        return (cmds == p2.cmds);
+    }
+
+
+    //
+    // returns the last coordinate of the most recently added sub
+    // path command
+    bool PdfPath::get_cur_pt(Coord& c) const
+    {
+        if (cmds.ops.empty() || cmds.ops.back() == CLOSE_PATH || cmds.ops.back() == RECT) {
             return false;
         }
 
-        for (std::list<PdfSubPathCmd *>::const_iterator i = cmds.begin(),
-                 j = p2.cmds.begin();
-             (i != cmds.end() && j != p2.cmds.end());
-             ++i, ++j)
-        {
-            if (*i != *j)
-                return false;
-        }
+        c = Coord(cmds.coords[cmds.coords.size() - 2], cmds.coords.back());
         return true;
     }
 
-
     //
-    // extracts the last coordinate from the most recently added sub
-    // path command
-    bool PdfPath::get_cur_pt(Coord& c) const
+    // copy of the commands relative to the first point so paths that
+    // only differ in placement can be compared
+    bool PdfPath::normalized_commands(Commands& c, Coord& origin) const
     {
-        // fetch the latest command and grab its coordinates
-        return cmds.back()->get_cur_pt(c);
+        if (cmds.coords.size() < 2) {
+            return false;
+        }
+
+        origin = Coord(cmds.coords[0], cmds.coords[1]);
+
+        c.ops = cmds.ops;
+        c.coords.resize(cmds.coords.size());
+        for (uintmax_t ii = 0; ii < cmds.coords.size(); ii += 2) {
+            c.coords[ii]     = cmds.coords[ii] - origin.x;
+            c.coords[ii + 1] = cmds.coords[ii + 1] - origin.y;
+        }
+        return true;
     }
 
     //
     // move_to is always the start of a path
     void PdfPath::move_to(const Coord& c)
     {
-        cmds.push_back( new PdfMoveTo(c) );
+        cmds.push(MOVE_TO);
+        cmds.push(c);
 
         // set the bounds to this first coord
         bounds.expand(c);
@@ -278,7 +220,10 @@ namespace pdftoedn
     // move_to is then followed by a curve_to with three coords
     void PdfPath::curve_to(const Coord& c1, const Coord& c2, const Coord& c3)
     {
-        cmds.push_back( new PdfCurveTo(c1, c2, c3) );
+        cmds.push(CURVE_TO);
+        cmds.push(c1);
+        cmds.push(c2);
+        cmds.push(c3);
 
         // resize bounding box if needed
         bounds.expand(c1);
@@ -294,10 +239,11 @@ namespace pdftoedn
     // or a line_to
     void PdfPath::line_to(const Coord& c)
     {
-        cmds.push_back( new PdfLineTo(c) );
+        cmds.push(LINE_TO);
+        cmds.push(c);
         bounds.expand(c);
 
-        if (shape == UNKNOWN && cmds.size() > 5) {
+        if (shape == UNKNOWN && cmds.ops.size() > 5) {
             shape = IRREGULAR;
         }
     }
@@ -306,20 +252,23 @@ namespace pdftoedn
     // mark a path closed
     void PdfPath::close()
     {
-        cmds.push_back( new PdfClosePath );
+        cmds.push(CLOSE_PATH);
 
         // check if rectangular
-        if (shape == UNKNOWN && cmds.size() == 5) {
+        if (shape == UNKNOWN && cmds.ops.size() == 5) {
             Coord c[4];
-            std::list<PdfSubPathCmd*>::const_iterator ci = std::next(cmds.begin());
+            const double* xy = &cmds.coords[2]; // past the move_to
 
-            for (uint8_t ii = 0; ci != cmds.end(); ++ci, ++ii) {
-                if ((*ci)->is_curved()) {
+            for (uint8_t ii = 0; ii < 4; ++ii) {
+                if (cmds.ops[ii + 1] == CURVE_TO) {
                     // there's a curve command.. break out
                     return;
                 }
 
-                (*(ci))->get_cur_pt(c[ii]);
+                if (cmds.ops[ii + 1] != CLOSE_PATH) {
+                    c[ii] = Coord(xy[0], xy[1]);
+                    xy += 2;
+                }
             }
 
             // build two bounding boxes with the four corners and compare them
@@ -335,6 +284,188 @@ namespace pdftoedn
     }
 
 
+    //
+    // batched version of move_to followed by line_to / curve_to
+    // calls. Points are transformed straight into the coordinate
+    // array and the bounds are updated in the same pass
+    void PdfPath::add_subpath(const PdfTM& ctm, const double* x, const double* y,
+                              const uint8_t* curve, uintmax_t num_points, bool closed)
+    {
+        if (num_points == 0) {
+            return;
+        }
+
+        uintmax_t base = cmds.coords.size();
+        cmds.coords.resize(base + 2 * num_points);
+        ctm.transform_points(x, y, num_points, &cmds.coords[base], bounds);
+
+        cmds.push(MOVE_TO);
+        for (uintmax_t j = 1; j < num_points; ++j) {
+            // a truncated curve is output as lines so the
+            // coordinates stay in step with the commands
+            if (curve[j] && (j + 2 < num_points)) {
+                cmds.push(CURVE_TO);
+                j += 2;
+                shape = IRREGULAR;
+            } else {
+                cmds.push(LINE_TO);
+            }
+        }
+
+        // same as line_to: more than a close + 4 lines can't be a
+        // rectangle
+        if (shape == UNKNOWN && cmds.ops.size() > 5) {
+            shape = IRREGULAR;
+        }
+
+        if (closed) {
+            close();
+        }
+    }
+
+
+    //
+    // if a closed rectangle starts at the given move_to, returns the
+    // number of commands it spans (move_to, 3 or 4 line_to, close);
+    // 0 otherwise. Only rectangles whose first edge is horizontal
+    // can be stored as their corners without losing the starting
+    // point or direction
+    uintmax_t PdfPath::rect_length(uintmax_t op_idx, const double* xy) const
+    {
+        const std::vector<uint8_t>& ops = cmds.ops;
+        if (op_idx + 4 >= ops.size() ||
+            ops[op_idx + 1] != LINE_TO || ops[op_idx + 2] != LINE_TO || ops[op_idx + 3] != LINE_TO) {
+            return 0;
+        }
+
+        uintmax_t len;
+        if (ops[op_idx + 4] == CLOSE_PATH) {
+            len = 5;
+        } else if (ops[op_idx + 4] == LINE_TO && op_idx + 5 < ops.size() && ops[op_idx + 5] == CLOSE_PATH &&
+                   xy[8] == xy[0] && xy[9] == xy[1]) {
+            // explicit line back to the start
+            len = 6;
+        } else {
+            return 0;
+        }
+
+        // [x1 y1] [x2 y1] [x2 y2] [x1 y2]
+        if (xy[3] == xy[1] && xy[4] == xy[2] && xy[6] == xy[0] && xy[7] == xy[5]) {
+            return len;
+        }
+        return 0;
+    }
+
+    //
+    // commands are rewritten into a new list. Merged line_to's only
+    // drop points that lie on the segment between their neighbours
+    // (in the same direction) so fills and strokes, including
+    // dashes, are unaffected
+    void PdfPath::compact()
+    {
+        Commands out;
+        out.ops.reserve(cmds.ops.size());
+        out.coords.reserve(cmds.coords.size());
+
+        const double* xy = cmds.coords.data();
+        for (uintmax_t ii = 0; ii < cmds.ops.size(); ++ii) {
+            uint8_t op = cmds.ops[ii];
+
+            if (op == MOVE_TO) {
+                uintmax_t len = rect_length(ii, xy);
+                if (len > 0) {
+                    out.push(RECT);
+                    out.coords.insert(out.coords.end(), xy, xy + 2);
+                    out.coords.insert(out.coords.end(), xy + 4, xy + 6);
+                    xy += 2 * (len - 1);
+                    ii += len - 1;
+                    continue;
+                }
+            }
+            else if (op == LINE_TO && out.ops.size() > 1 && out.ops.back() == LINE_TO &&
+                     out.ops[out.ops.size() - 2] != CLOSE_PATH && out.ops[out.ops.size() - 2] != RECT) {
+                // previous point and the one before it
+                double* p1 = &out.coords[out.coords.size() - 2];
+                const double* p0 = p1 - 2;
+                double dx1 = p1[0] - p0[0], dy1 = p1[1] - p0[1];
+                double dx2 = xy[0] - p1[0], dy2 = xy[1] - p1[1];
+                double len1 = std::hypot(dx1, dy1), len2 = std::hypot(dx2, dy2);
+
+                if (len1 > 0 && len2 > 0 &&
+                    (dx1 * dx2 + dy1 * dy2) > 0 &&
+                    std::abs(dx1 * dy2 - dy1 * dx2) <= COLLINEAR_TOLERANCE * len1 * len2) {
+                    // extend the last segment instead
+                    p1[0] = xy[0];
+                    p1[1] = xy[1];
+                    xy += 2;
+                    continue;
+                }
+            }
+
+            out.push(static_cast<Op>(op));
+            uintmax_t num_coords = (op == CURVE_TO ? 6 : (op == CLOSE_PATH ? 0 : 2));
+            out.coords.insert(out.coords.end(), xy, xy + num_coords);
+            xy += num_coords;
+        }
+
+        std::swap(cmds, out);
+    }
+
+
+    //
+    // command list EDN output, written directly to avoid building a
+    // node per command and coordinate:
+    //   [[:move_to [x y]] [:curve_to [[x y] [x y] [x y]]] [:close_path]]
+    std::ostream& PdfPath::Commands::to_edn(std::ostream& o) const
+    {
+        // change -0 weirdness to just 0, same as Coord
+        auto point = [&](const double* xy) {
+            o << '[' << std::dec << (xy[0] == 0 ? 0.0 : xy[0])
+              << ' ' << (xy[1] == 0 ? 0.0 : xy[1]) << ']';
+            return xy + 2;
+        };
+
+        const double* xy = coords.data();
+
+        o << '[';
+        for (uintmax_t ii = 0; ii < ops.size(); ++ii) {
+            if (ii > 0) {
+                o << ' ';
+            }
+
+            o << '[' << SYMBOL_PATH_COMMANDS[ ops[ii] ];
+            switch (ops[ii]) {
+              case MOVE_TO:
+              case LINE_TO:
+                  o << ' ';
+                  xy = point(xy);
+                  break;
+              case CURVE_TO:
+                  o << " [";
+                  xy = point(xy);
+                  o << ' ';
+                  xy = point(xy);
+                  o << ' ';
+                  xy = point(xy);
+                  o << ']';
+                  break;
+              case RECT:
+                  o << " [";
+                  xy = point(xy);
+                  o << ' ';
+                  xy = point(xy);
+                  o << ']';
+                  break;
+              default:
+                  break;
+            }
+            o << ']';
+        }
+        o << ']';
+        return o;
+    }
+
+
     //
     // path EDN output
     util::edn::Hash& PdfPath::to_edn_hash(util::edn::Hash& path_h) const
@@ -344,12 +475,8 @@ namespace pdftoedn
         // contains the type, commands and attributes
         path_h.push( PdfGfxCmd::SYMBOL_TYPE, SYMBOL_TYPE_PATH );
 
-        // traverse the cmds inserting them into an array
-        util::edn::Vector path_a(cmds.size() + 1);
-        for (const PdfSubPathCmd* c : cmds) {
-            path_a.push( c );
-        }
-        path_h.push( SYMBOL_COMMAND_LIST, path_a );
+        // commands write themselves out
+        path_h.push( SYMBOL_COMMAND_LIST, &cmds );
 
         // add the path bounds
         path_h.push( BoundingBox::SYMBOL, bounds );
@@ -364,6 +491,111 @@ namespace pdftoedn
     }
 
 
+    //
+    // subpaths run from a move_to (or rect) to the next one. Nearby
+    // points are measured on each axis, as pixels would be
+    bool PdfPath::decimate(double tolerance)
+    {
+        const std::vector<uint8_t>& ops = cmds.ops;
+        Commands out;
+        out.ops.reserve(ops.size());
+        out.coords.reserve(cmds.coords.size());
+
+        auto is_near = [=](const Coord& c, const double* xy) {
+            return (std::abs(xy[0] - c.x) <= tolerance && std::abs(xy[1] - c.y) <= tolerance);
+        };
+
+        const double* xy = cmds.coords.data();
+        uintmax_t ii = 0;
+        while (ii < ops.size()) {
+            uintmax_t end = ii + 1;
+            const double* end_xy = xy + 2 * PATH_COMMAND_POINTS[ ops[ii] ];
+            while (end < ops.size() && ops[end] != MOVE_TO && ops[end] != RECT) {
+                end_xy += 2 * PATH_COMMAND_POINTS[ ops[end] ];
+                ++end;
+            }
+
+            double x_lo = xy[0], y_lo = xy[1], x_hi = xy[0], y_hi = xy[1];
+            for (const double* p = xy; p < end_xy; p += 2) {
+                x_lo = std::min(x_lo, p[0]);  x_hi = std::max(x_hi, p[0]);
+                y_lo = std::min(y_lo, p[1]);  y_hi = std::max(y_hi, p[1]);
+            }
+
+            if (ops[ii] == MOVE_TO && end - ii > 1 &&
+                x_hi - x_lo <= tolerance && y_hi - y_lo <= tolerance) {
+                // smaller than a pixel
+                out.push(RECT);
+                out.push(Coord(x_lo, y_lo));
+                out.push(Coord(x_hi, y_hi));
+            }
+            else {
+                // keep the last of a run of dropped points so the
+                // subpath still ends where it did
+                Coord start, last, pending;
+                bool has_pending = false;
+                auto flush = [&]() {
+                    if (has_pending) {
+                        out.push(LINE_TO);
+                        out.push(pending);
+                        last = pending;
+                        has_pending = false;
+                    }
+                };
+
+                const double* p = xy;
+                for (uintmax_t jj = ii; jj < end; ++jj) {
+                    uint8_t op = ops[jj];
+                    switch (op) {
+                      case MOVE_TO:
+                          out.push(MOVE_TO);
+                          start = last = Coord(p[0], p[1]);
+                          out.push(start);
+                          break;
+                      case RECT:
+                          out.push(RECT);
+                          out.coords.insert(out.coords.end(), p, p + 4);
+                          break;
+                      case CLOSE_PATH:
+                          flush();
+                          out.push(CLOSE_PATH);
+                          last = start;
+                          break;
+                      default:
+                          {
+                              // curves that fit in the tolerance become
+                              // lines
+                              const double* end_pt = (op == CURVE_TO ? p + 4 : p);
+                              if (is_near(last, p) && (op != CURVE_TO || (is_near(last, p + 2) && is_near(last, p + 4)))) {
+                                  pending = Coord(end_pt[0], end_pt[1]);
+                                  has_pending = true;
+                                  break;
+                              }
+                              has_pending = false;
+                              out.push(static_cast<Op>(op));
+                              out.coords.insert(out.coords.end(), p, end_pt + 2);
+                              last = Coord(end_pt[0], end_pt[1]);
+                          }
+                          break;
+                    }
+                    p += 2 * PATH_COMMAND_POINTS[op];
+                }
+                flush();
+            }
+
+            ii = end;
+            xy = end_xy;
+        }
+
+        if (out == cmds) {
+            return false;
+        }
+        cmds.ops.swap(out.ops);
+        cmds.coords.swap(out.coords);
+        shape = IRREGULAR;
+        return true;
+    }
+
+
     // -------------------------------------------------------
     // Document Paths
     //
@@ -400,25 +632,46 @@ namespace pdftoedn
             return false;
         }
 
-        // equal number of cmds?
-        if (cmds.size() != p2.cmds.size()) {
-            //            std::cerr << "  * different cmd count" << std::endl;
+        // command list equal?
+        if (cmds != p2.cmds) {
+            //            std::cerr << "  * different subpaths" << std::endl;
             return false;
         }
 
-        // command list equal?
-        for (std::list<PdfSubPathCmd *>::const_reverse_iterator ii = cmds.rbegin(),
-                 jj = p2.cmds.rbegin();
-             ii != cmds.rend();
-             ++ii, ++jj)
-        {
-            if (!((*ii)->equals(*(*jj)))) {
-                //                std::cerr << "  * different subpaths" << std::endl;
-                return false;
-            }
+        return true;
+    }
+
+
+    //
+    // paths painted one after another can be combined if they're the
+    // same type with the same attribs (interned, so same entry) and
+    // clip. Subpaths of one fill interact through the winding rule so
+    // fills must not overlap; overlapping strokes must be opaque so
+    // painting the overlap once is the same as twice
+    bool PdfDocPath::can_merge(const PdfDocPath& p2) const
+    {
+        if (path_type == CLIP || path_type != p2.path_type ||
+            &attribs != &p2.attribs || clip_id != p2.clip_id || even_odd != p2.even_odd) {
+            return false;
         }
 
-        return true;
+        if (bounding_box().is_clipped_by(p2.bounding_box()) == BoundingBox::FULLY_CLIPPED) {
+            return true;
+        }
+
+        return (path_type == STROKE &&
+                attribs.stroke.opacity == 1.0 &&
+                attribs.blend_mode == GfxAttribs::NORMAL_BLEND);
+    }
+
+    //
+    // append p2's subpaths
+    void PdfDocPath::merge(const PdfDocPath& p2)
+    {
+        cmds.ops.insert(cmds.ops.end(), p2.cmds.ops.begin(), p2.cmds.ops.end());
+        cmds.coords.insert(cmds.coords.end(), p2.cmds.coords.begin(), p2.cmds.coords.end());
+        bounds.expand(p2.bounding_box());
+        shape = IRREGULAR;
     }
 
 
@@ -429,7 +682,16 @@ namespace pdftoedn
         // ready to produce the output - a hash contains the path data
         // and attributes
         util::edn::Hash path_h(4);
-        to_edn_hash(path_h);
+        if (symbol_idx != -1) {
+            // the geometry is in the document's symbols
+            path_h.reserve(4);
+            path_h.push( PdfGfxCmd::SYMBOL_TYPE, SYMBOL_TYPE_PATH );
+            path_h.push( SYMBOL_SYMBOL_IDX, symbol_idx );
+            path_h.push( SYMBOL_OFFSET, symbol_offset );
+            path_h.push( BoundingBox::SYMBOL, bounds );
+        } else {
+            to_edn_hash(path_h);
+        }
 
         path_h.push( SYMBOL_PATH_TYPE, SYMBOL_PATH_TYPES[path_type] );
 
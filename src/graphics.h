@@ -21,7 +21,6 @@
 #include <ostream>
 #include <climits>
 #include <cstdlib>
-#include <list>
 #include <vector>
 #include "base_types.h"
 
@@ -48,41 +47,31 @@ namespace pdftoedn
 
 
     // -------------------------------------------------------
-    // subpath commands (commands with coordinates)
+    // path building. Commands are stored flat: one opcode per
+    // command and the x, y values of their coordinates (one point
+    // for move_to and line_to, three for curve_to, none for close)
+    // in a single array
     //
-    class PdfSubPathCmd : public PdfGfxCmd
-    {
+    class PdfPath : public PdfGfxCmd {
     public:
-        PdfSubPathCmd(const pdftoedn::Symbol& cmd_symbol) :
-            PdfGfxCmd(cmd_symbol) {}
-        PdfSubPathCmd(const pdftoedn::Symbol& cmd_symbol,
-                      const Coord& c) :
-            PdfGfxCmd(cmd_symbol) {
-            coords.push_back(c);
-        }
-        PdfSubPathCmd(const pdftoedn::Symbol& cmd_name,
-                      const Coord& c1,
-                      const Coord& c2,
-                      const Coord& c3);
-
-        virtual bool is_curved() const { return false; }
-        bool get_cur_pt(Coord& c) const;
-        bool equals(const PdfSubPathCmd& c) const { return (coords == c.coords); }
+        enum eShape { UNKNOWN, IRREGULAR, RECTANGULAR };
 
-        virtual std::ostream& to_edn(std::ostream&) const;
+        // RECT is a closed subpath with corners [x1 y1] [x2 y1] [x2 y2]
+        // [x1 y2], stored as its two opposite corners
+        enum Op : uint8_t { MOVE_TO, LINE_TO, CURVE_TO, CLOSE_PATH, RECT };
 
-    protected:
-        std::list<Coord> coords;
-    };
+        struct Commands : public gemable {
+            std::vector<uint8_t> ops;
+            std::vector<double> coords;
 
+            bool operator==(const Commands& c) const { return (ops == c.ops && coords == c.coords); }
+            bool operator!=(const Commands& c) const { return !(*this == c); }
 
+            void push(Op op) { ops.push_back(op); }
+            void push(const Coord& c) { coords.push_back(c.x); coords.push_back(c.y); }
 
-    // -------------------------------------------------------
-    // path building
-    //
-    class PdfPath : public PdfGfxCmd {
-    public:
-        enum eShape { UNKNOWN, IRREGULAR, RECTANGULAR };
+            virtual std::ostream& to_edn(std::ostream& o) const;
+        };
 
         static const pdftoedn::Symbol SYMBOL_TYPE_PATH;
         static const pdftoedn::Symbol SYMBOL_COMMAND_LIST;
@@ -90,7 +79,6 @@ namespace pdftoedn
         // constructors - stroke or fill paths
         PdfPath() : PdfGfxCmd(SYMBOL_TYPE_PATH), shape(UNKNOWN) { }
         PdfPath(const pdftoedn::Symbol& cmd_name) : PdfGfxCmd(cmd_name), shape(UNKNOWN) { }
-        virtual ~PdfPath();
 
         bool equals(const PdfPath& p2) const;
 
@@ -99,20 +87,47 @@ namespace pdftoedn
         void curve_to(const Coord& c1, const Coord& c2, const Coord& c3);
         void line_to(const Coord& c);
         void close();
-
-        uintmax_t length() const { return cmds.size(); }
+        // append a whole subpath, transforming its points in one
+        // batch. As in poppler's GfxSubpath, a curve flag marks the
+        // first control point of a curve_to
+        void add_subpath(const PdfTM& ctm, const double* x, const double* y,
+                         const uint8_t* curve, uintmax_t num_points, bool closed);
+
+        // lossless rewrite of the commands: closed rectangles become
+        // a :rect and straight runs of line_to are merged
+        void compact();
+        // lossy simplification for a device of the given resolution
+        // (tolerance in pt): subpaths smaller than that become a
+        // :rect and points closer than that to the previous one are
+        // dropped. Returns true if anything changed. The bounds are
+        // not recomputed: they stay the original ones, which still
+        // enclose the simplified commands
+        bool decimate(double tolerance);
+
+        // max. deviation, relative to the segment lengths, for a
+        // point to be considered on a straight line
+        static const double COLLINEAR_TOLERANCE;
+
+        uintmax_t length() const { return cmds.ops.size(); }
+        uintmax_t num_points() const { return cmds.coords.size() / 2; }
         bool is_rectangular() const { return (shape == RECTANGULAR); }
         bool get_cur_pt(Coord& c) const;
         BoundingBox bounding_box() const { return bounds.bounding_box(); }
+        // the commands translated so the first point is at the
+        // origin; false if the path is empty
+        bool normalized_commands(Commands& c, Coord& origin) const;
 
         virtual std::ostream& to_edn(std::ostream&) const;
 
     protected:
         Bounds bounds;
         eShape shape;
-        std::list<PdfSubPathCmd *> cmds;
+        Commands cmds;
 
         virtual util::edn::Hash& to_edn_hash(util::edn::Hash& h) const;
+
+    private:
+        uintmax_t rect_length(uintmax_t op_idx, const double* xy) const;
     };
 
 
@@ -221,6 +236,15 @@ namespace pdftoedn
         bool operator!=(const GfxAttribs& a2) const { return !equals(a2); }
         bool equals(const GfxAttribs& a2) const;
 
+        // predicates for interning attribs in a page table. Unlike
+        // equals(), these compare every field
+        struct hash {
+            size_t operator()(const GfxAttribs& a) const;
+        };
+        struct eq {
+            bool operator()(const GfxAttribs& a1, const GfxAttribs& a2) const;
+        };
+
         // data
         StrokeFill stroke;
         StrokeFill fill;
@@ -251,6 +275,8 @@ namespace pdftoedn
         static const pdftoedn::Symbol SYMBOL_EVEN_ODD;
         static const pdftoedn::Symbol SYMBOL_ID;
         static const pdftoedn::Symbol SYMBOL_CLIP_TO;
+        static const pdftoedn::Symbol SYMBOL_SYMBOL_IDX;
+        static const pdftoedn::Symbol SYMBOL_OFFSET;
 
         enum Type {
             STROKE,
@@ -264,14 +290,16 @@ namespace pdftoedn
             EVEN_ODD_RULE_ENABLED
         };
 
-        // constructor
+        // constructor - gfx_attribs must outlive the path (they are
+        // interned by the page)
         PdfDocPath(Type doc_path_type,
                    const GfxAttribs& gfx_attribs,
                    EvenOddRule even_odd_flag) :
             path_type(doc_path_type),
             attribs(gfx_attribs),
             even_odd(even_odd_flag),
-            clip_id(-1)
+            clip_id(-1),
+            symbol_idx(-1)
         { }
 
         // accessors
@@ -281,12 +309,23 @@ namespace pdftoedn
 
         void set_clip_id(intmax_t id) { clip_id = id; }
         void clip_bounds(const BoundingBox& clip_bbox) { bounds.clip(clip_bbox); }
+        // output as a reference to a document symbol placed at the
+        // offset instead of the commands
+        void set_symbol(intmax_t idx, const Coord& offset) {
+            symbol_idx = idx;
+            symbol_offset = offset;
+        }
+
+        // can p2 be added to this path as more subpaths without
+        // changing what's painted?
+        bool can_merge(const PdfDocPath& p2) const;
+        void merge(const PdfDocPath& p2);
 
         virtual std::ostream& to_edn(std::ostream& o) const;
 
     protected:
         Type path_type;
-        GfxAttribs attribs;
+        const GfxAttribs& attribs;
         EvenOddRule even_odd; // applies only to fill & clip
 
         // if this is a CLIP Path, this is the id to be used in
@@ -294,6 +333,9 @@ namespace pdftoedn
         // path to clip to (when != -1)
         intmax_t clip_id;
 
+        intmax_t symbol_idx;
+        Coord symbol_offset;
+
         util::edn::Hash& attribs_to_edn_hash(util::edn::Hash& h) const;
     };
 
@@ -68,6 +68,9 @@ int main(int argc, char** argv)
     std::string pdf_filename, pdf_owner_password, pdf_user_password, edn_output_filename, font_map_file;
     bool show_font_list = false;
     intmax_t page_number = -1;
+    uintmax_t x_delta_units = 0;
+    uintmax_t max_path_points = 0;
+    uintmax_t lod_dpi = pdftoedn::Options::DEFAULT_LOD_DPI;
 
     try
     {
@@ -78,26 +81,50 @@ int main(int argc, char** argv)
              "REQUIRED: Destination file path to write output to.")
             ("use_page_crop_box,a", po::bool_switch(&flags.use_page_crop_box),
              "Use page crop box instead of media box when reading page content.")
+            ("text_blocks,B",       po::bool_switch(&flags.include_text_blocks),
+             "Segment text into blocks in reading order and include them in the output.")
+            ("compact_paths,c",     po::bool_switch(&flags.compact_paths),
+             "Output paths in a compact form (rects, merged lines and paths).")
+            ("cull_chars,C",        po::bool_switch(&flags.cull_chars),
+             "Drop each character outside the page or clip instead of checking whole spans.")
             ("debug_meta,D",        po::bool_switch(&flags.include_debug_info),
              "Include additional debug metadata in output.")
             ("show_font_map_list,F",po::bool_switch(&show_font_list),
              "Display the configured font substitution list and exit.")
             ("force_output,f"  ,    po::bool_switch(&flags.force_output_write),
              "Overwrite output file if it exists.")
+            ("gradients,g",         po::bool_switch(&flags.native_shading),
+             "Output smooth shadings as gradient descriptors instead of many small fills.")
             ("invisible_text,i",    po::bool_switch(&flags.include_invisible_text),
              "Include invisible text in output (for use with OCR'd documents).")
             ("links_only,l",        po::bool_switch(&flags.link_output_only),
              "Extract only link data.")
+            ("text_lines,L",        po::bool_switch(&flags.include_text_lines),
+             "Group text spans into words and lines and include them in the output.")
             ("font_map_file,m",     po::value<std::string>(&font_map_file),
              "JSON font mapping configuration file to use for this run.")
+            ("max_path_points_per_page,M", po::value<uintmax_t>(&max_path_points),
+             "Simplify paths once a page's paths have this many points in total; drop them past twice that.")
             ("omit_outline,O",      po::bool_switch(&flags.omit_outline),
              "Don't extract outline data.")
             ("page_number,p",       po::value<intmax_t>(&page_number),
              "Extract data for only this page.")
+            ("tiling_patterns,P",   po::bool_switch(&flags.include_tiling_patterns),
+             "Output tiling pattern fills, each pattern's tile defined once.")
+            ("lod_dpi,r",           po::value<uintmax_t>(&lod_dpi),
+             "Resolution paths are simplified for when over the page's point budget (default 72).")
+            ("shared_content,s",    po::bool_switch(&flags.dedupe_shared_content),
+             "Output text repeated across pages (headers, footers) once in the document meta.")
+            ("symbols,S",           po::bool_switch(&flags.path_symbols),
+             "Output path shapes used more than once in the document meta as symbols.")
             ("owner_password,t",    po::value<std::string>(&pdf_owner_password),
              "PDF owner password if document is encrypted.")
             ("user_password,u",     po::value<std::string>(&pdf_user_password),
              "PDF user password if document is encrypted.")
+            ("x_deltas,x",          po::value<uintmax_t>(&x_delta_units),
+             "Output text x positions as integer deltas in 1/N pt units (e.g., 100).")
+            ("forms,X",             po::bool_switch(&flags.cache_forms),
+             "Read each Form XObject once and output placements that refer to it.")
             ("filename",            po::value<std::string>(&pdf_filename)->required(),
              "PDF document to process.")
             ("version,v",
@@ -134,6 +161,10 @@ int main(int argc, char** argv)
                     return pdftoedn::ErrorTracker::CODE_INIT_ERROR;
                 }
             }
+            if ( vm.count("lod_dpi") && vm["lod_dpi"].as<uintmax_t>() == 0) {
+                std::cout << "Invalid LOD resolution 0" << std::endl;
+                return pdftoedn::ErrorTracker::CODE_INIT_ERROR;
+            }
             po::notify(vm);
         }
         catch (po::error& e) {
@@ -164,7 +195,10 @@ int main(int argc, char** argv)
                                               edn_output_filename,
                                               font_map_file,
                                               flags,
-                                              (page_number >= 0 ? page_number : -1));
+                                              (page_number >= 0 ? page_number : -1),
+                                              x_delta_units,
+                                              max_path_points,
+                                              lod_dpi);
     }
     catch (std::exception& e) {
         std::cout << e.what() << std::endl;
@@ -0,0 +1,90 @@
+//
+// Copyright 2016-2017 Ed Porras
+//
+// This file is part of pdftoedn.
+//
+// pdftoedn is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// pdftoedn is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with pdftoedn.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <cmath>
+
+#include "path_symbols.h"
+#include "util_edn.h"
+
+namespace pdftoedn
+{
+    static const pdftoedn::Symbol SYMBOL_NUM_USES            = "num_uses";
+
+    const uintmax_t PathSymbols::MIN_COMMANDS                = 4;
+    const uintmax_t PathSymbols::MIN_USES                    = 2;
+
+
+    // =============================================
+    // PathSymbols
+    //
+    bool PathSymbols::Key::operator<(const Key& k) const
+    {
+        if (ops != k.ops) return (ops < k.ops);
+        return (coords < k.coords);
+    }
+
+    //
+    // geometry is compared to 1/100 pt; the first occurrence's
+    // commands are the ones output
+    bool PathSymbols::make_key(const PdfPath& path, Key& key, PdfPath::Commands& geometry, Coord& origin)
+    {
+        if (path.length() < MIN_COMMANDS || !path.normalized_commands(geometry, origin)) {
+            return false;
+        }
+
+        key.ops = geometry.ops;
+        key.coords.resize(geometry.coords.size());
+        for (uintmax_t ii = 0; ii < geometry.coords.size(); ++ii) {
+            key.coords[ii] = std::lround(geometry.coords[ii] * 100);
+        }
+        return true;
+    }
+
+    void PathSymbols::add(const Key& key, const PdfPath::Commands& geometry)
+    {
+        symbols.add(key, [&]() { return geometry; });
+    }
+
+    void PathSymbols::select()
+    {
+        symbols.select(MIN_USES);
+    }
+
+    intmax_t PathSymbols::find(const Key& key) const
+    {
+        return symbols.find(key);
+    }
+
+    //
+    // [{:commands [...] :num_uses N} ...]
+    std::ostream& PathSymbols::to_edn(std::ostream& o) const
+    {
+        util::edn::Vector symbols_a(symbols.size());
+
+        symbols.for_each([&](const Key&, const PdfPath::Commands& cmds, uintmax_t num_uses) {
+            util::edn::Hash entry_h(2);
+            entry_h.push( PdfPath::SYMBOL_COMMAND_LIST,         &cmds );
+            entry_h.push( SYMBOL_NUM_USES,                      num_uses );
+            symbols_a.push( entry_h );
+        });
+
+        o << symbols_a;
+        return o;
+    }
+
+} // namespace
@@ -0,0 +1,72 @@
+//
+// Copyright 2016-2017 Ed Porras
+//
+// This file is part of pdftoedn.
+//
+// pdftoedn is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// pdftoedn is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with pdftoedn.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <ostream>
+#include <vector>
+
+#include "base_types.h"
+#include "graphics.h"
+#include "repeated_entries.h"
+
+namespace pdftoedn
+{
+    // -------------------------------------------------------
+    // path geometry repeated in the document (logos, checkboxes,
+    // bullets drawn inline in each page's content). Paths are
+    // fingerprinted by their commands, relative to their first point,
+    // during a pre-pass; shapes used more than once are output once
+    // in the document meta and pages refer to them by index and
+    // offset instead of including the commands
+    //
+    class PathSymbols : public gemable {
+    public:
+        // rounded geometry - independent of placement and attribs
+        struct Key {
+            std::vector<uint8_t> ops;
+            std::vector<intmax_t> coords; // 1/100 pt
+
+            bool operator<(const Key& k) const;
+        };
+
+        // builds the key of a path and its translation-normalized
+        // commands. Short paths are not worth sharing
+        static bool make_key(const PdfPath& path, Key& key, PdfPath::Commands& geometry, Coord& origin);
+
+        // pre-pass: count uses of each shape
+        void add(const Key& key, const PdfPath::Commands& geometry);
+        // keep the shapes used enough times
+        void select();
+
+        // index of the symbol matching the key or -1
+        intmax_t find(const Key& key) const;
+
+        std::ostream& to_edn(std::ostream& o) const;
+
+        // a path must have at least this many commands and be used
+        // this many times to be shared
+        static const uintmax_t MIN_COMMANDS;
+        static const uintmax_t MIN_USES;
+
+    private:
+        // the first occurrence's commands, counted on every use
+        RepeatedEntries<Key, PdfPath::Commands> symbols;
+    };
+
+} // namespace
@@ -0,0 +1,93 @@
+//
+// Copyright 2016-2017 Ed Porras
+//
+// This file is part of pdftoedn.
+//
+// pdftoedn is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// pdftoedn is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with pdftoedn.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "pattern.h"
+#include "doc_page.h"
+#include "shading.h"
+#include "util_edn.h"
+
+namespace pdftoedn
+{
+    const pdftoedn::Symbol PdfTilingPattern::SYMBOL_ID               = "id";
+    const pdftoedn::Symbol PdfTilingPattern::SYMBOL_STEP             = "step";
+
+    const pdftoedn::Symbol PdfPatternFill::SYMBOL_TYPE_PATTERN_FILL  = "pattern_fill";
+    const pdftoedn::Symbol PdfPatternFill::SYMBOL_PATTERN_ID         = "pattern_id";
+
+    // =============================================
+    // PdfTilingPattern
+    //
+    PdfTilingPattern::~PdfTilingPattern()
+    {
+        delete content;
+    }
+
+    //
+    // {:id n, :bbox [...], :step [x y], :resources {...}, :text_spans
+    // [...], :graphics [...]}
+    std::ostream& PdfTilingPattern::to_edn(std::ostream& o) const
+    {
+        util::edn::Hash pattern_h(6);
+        pattern_h.push( SYMBOL_ID,                   idx );
+        pattern_h.push( BoundingBox::SYMBOL,         bbox );
+
+        util::edn::Vector step_a(2);
+        step_a.push( x_step );
+        step_a.push( y_step );
+        pattern_h.push( SYMBOL_STEP,                 step_a );
+
+        content->content_to_edn_hash(pattern_h);
+
+        o << pattern_h;
+        return o;
+    }
+
+
+    // =============================================
+    // PdfPatternFill
+    //
+
+    //
+    // {:type :pattern_fill, :bbox [...], :pattern_id n, :transform
+    // [a b c d e f]}
+    std::ostream& PdfPatternFill::to_edn(std::ostream& o) const
+    {
+        util::edn::Hash fill_h(5);
+        fill_h.push( SYMBOL_TYPE,                    cmd );
+        fill_h.push( BoundingBox::SYMBOL,            bbox );
+        fill_h.push( SYMBOL_PATTERN_ID,              pattern_idx );
+
+        util::edn::Vector tm_a(6);
+        tm_a.push( tm.a() );
+        tm_a.push( tm.b() );
+        tm_a.push( tm.c() );
+        tm_a.push( tm.d() );
+        tm_a.push( tm.e() );
+        tm_a.push( tm.f() );
+        fill_h.push( PdfShading::SYMBOL_TRANSFORM,   tm_a );
+
+        if (clip_path_id != -1) {
+            fill_h.push( PdfDocPath::SYMBOL_CLIP_TO, clip_path_id );
+        }
+
+        o << fill_h;
+        return o;
+    }
+
+} // namespace
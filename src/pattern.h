@@ -0,0 +1,93 @@
+//
+// Copyright 2016-2017 Ed Porras
+//
+// This file is part of pdftoedn.
+//
+// pdftoedn is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// pdftoedn is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with pdftoedn.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include <ostream>
+
+#include "base_types.h"
+#include "graphics.h"
+
+namespace pdftoedn
+{
+    class PdfPage;
+
+    // -------------------------------------------------------
+    // tile of a tiling pattern. Its content is interpreted once, in
+    // tile space (pattern space flipped y-down like a page, with the
+    // origin at the tile's bbox top-left corner), and collected in its
+    // own page-like container with its own resources. Owns the content
+    //
+    class PdfTilingPattern : public gemable {
+    public:
+        static const pdftoedn::Symbol SYMBOL_ID;
+        static const pdftoedn::Symbol SYMBOL_STEP;
+
+        PdfTilingPattern(uintmax_t pattern_id, double tile_width, double tile_height,
+                         double tile_x_step, double tile_y_step, PdfPage* tile_content) :
+            idx(pattern_id), bbox(0, 0, tile_width, tile_height),
+            x_step(tile_x_step), y_step(tile_y_step), content(tile_content)
+        { }
+        virtual ~PdfTilingPattern();
+
+        uintmax_t id() const { return idx; }
+
+        virtual std::ostream& to_edn(std::ostream& o) const;
+
+    private:
+        uintmax_t idx;
+        BoundingBox bbox;
+        double x_step, y_step;
+        PdfPage* content;
+
+        // prohibit
+        PdfTilingPattern(const PdfTilingPattern&);
+        PdfTilingPattern& operator=(const PdfTilingPattern&);
+    };
+
+
+    // -------------------------------------------------------
+    // area filled with a tiling pattern. Refers to the tile by id;
+    // the transform maps tile space to the page
+    //
+    class PdfPatternFill : public PdfGfxCmd {
+    public:
+        static const pdftoedn::Symbol SYMBOL_TYPE_PATTERN_FILL;
+        static const pdftoedn::Symbol SYMBOL_PATTERN_ID;
+
+        PdfPatternFill(uintmax_t pattern_id, const PdfTM& tile_tm, const BoundingBox& b) :
+            PdfGfxCmd(SYMBOL_TYPE_PATTERN_FILL),
+            pattern_idx(pattern_id), tm(tile_tm), bbox(b),
+            clip_path_id(-1)
+        { }
+
+        void set_clip_id(intmax_t clip_id) { clip_path_id = clip_id; }
+        void clip_bounds(const BoundingBox& clip_bbox) { bbox = bbox.clip(clip_bbox); }
+        const BoundingBox& bounding_box() const { return bbox; }
+
+        virtual std::ostream& to_edn(std::ostream& o) const;
+
+    private:
+        uintmax_t pattern_idx;
+        PdfTM tm;
+        BoundingBox bbox;
+        intmax_t clip_path_id;
+    };
+
+} // namespace
@@ -623,7 +623,10 @@ namespace pdftoedn
             return false;
         }
 
-        FEPathBuilder path_builder(path);
+        // unscaled outlines are in font units; normalize them to the
+        // em square so they can be scaled by the font size
+        FEPathBuilder path_builder(path, (ft_face->units_per_EM > 0) ?
+                                   (SCALING_BASE / ft_face->units_per_EM) : 1.0);
         FT_Outline_Decompose(&(o_glyph->outline), &outlineFuncs, &path_builder);
         if (path_builder.needs_close) {
             path_builder.path.close();
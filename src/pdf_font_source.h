@@ -208,6 +208,7 @@ namespace pdftoedn
         bool has_std_encoding() const { return (encoding && encoding->is_standard()); }
         bool has_to_unicode() const { return to_unicode; }
         const std::string& md5() const { return (code_to_gid ? code_to_gid->md5() : blob_md5); }
+        const std::string& font_blob_md5() const { return blob_md5; }
 
         const PdfRef& font_ref() const { return ref; }
         const std::string& font_name() const { return name; }
@@ -83,6 +83,8 @@ namespace pdftoedn
             ACTION_LAUNCH,
         };
 
+        const BoundingBox& bounding_box() const { return bbox; }
+
         // is the given point within this link? ideally should be the
         // center of a bbox
         bool encloses(const Coord& center) const {
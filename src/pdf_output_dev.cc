@@ -20,15 +20,18 @@
 #pragma implementation
 #endif
 
+#include <algorithm>
 #include <sstream>
 #include <vector>
 #include <assert.h>
 
 #include <poppler/Error.h>
 #include <poppler/Object.h>
+#include <poppler/Gfx.h>
 #include <poppler/GfxFont.h>
 #include <poppler/Page.h>
 #include <poppler/UTF.h>
+#include <poppler/goo/gmem.h>
 
 #include "pdf_output_dev.h"
 #include "font_engine.h"
@@ -38,6 +41,7 @@
 #include "util_encode.h"
 #include "util_xform.h"
 #include "edsel_options.h"
+#include "util.h"
 
 // debug
 //#define ENABLE_OP_TRACE            // dump traces to show op order
@@ -90,6 +94,16 @@ namespace pdftoedn
     // pdftoedn::OutputDev
     //------------------------------------------------------------------------
 
+    OutputDev::~OutputDev()
+    {
+        for (auto& p : tiling_patterns) {
+            delete p.second;
+        }
+        for (auto& p : forms) {
+            delete p.second;
+        }
+    }
+
     //
     // begin page processing
     // poppler >= 0.24.0 added the xref parameter to startPage
@@ -101,6 +115,9 @@ namespace pdftoedn
 
         int w, h, rot;
 
+        cur_state = state;
+        cur_page_num = pageNum;
+
         // set up graphics output for page
         if (state) {
             // setup HTML output for page
@@ -129,6 +146,8 @@ namespace pdftoedn
             delete pg_data;
         }
         pg_data = new pdftoedn::PdfPage(pageNum, w, h, rot);
+        pg_data->set_shared_content(shared_content);
+        pg_data->set_path_symbols(path_symbols);
 
         // finally, update the xref pointer with the font engine
         if (xref) {
@@ -150,12 +169,14 @@ namespace pdftoedn
 
         // close page collection
         pg_data->finalize();
+        cur_state = NULL;
     }
 
     //
     // state save & restore
     void OutputDev::saveState(GfxState* state)
     {
+        cur_state = state;
         DBG_TRACE(std::cerr << __FUNCTION__ << std::endl);
 
         pg_data->push_gfx_state();
@@ -163,17 +184,27 @@ namespace pdftoedn
 
     void OutputDev::restoreState(GfxState* state)
     {
+        cur_state = state;
         DBG_TRACE(std::cerr << __FUNCTION__ << std::endl);
 
         pg_data->pop_gfx_state();
     }
 
+    //
+    // only tracked for drawForm()
+    void OutputDev::updateCTM(GfxState *state, double /*m11*/, double /*m12*/,
+                              double /*m21*/, double /*m22*/, double /*m31*/, double /*m32*/)
+    {
+        cur_state = state;
+    }
+
 
     //
     //  Text and Font processing
     //
     void OutputDev::updateFont(GfxState *state)
     {
+        cur_state = state;
         GfxFont *gfx_font = state->getFont();
         if (!gfx_font) {
             return;
@@ -216,7 +247,103 @@ namespace pdftoedn
     //
 
     //
-    // new character to be 'drawn'
+    // new string to be 'drawn'. Mirrors the glyph walk in poppler's
+    // Gfx::doShowText but reads the text state, matrices and metrics
+    // once for the whole string instead of once per glyph
+    void OutputDev::drawString(GfxState *state, GooString *s)
+    {
+        DBG_TRACE_TXT(std::cerr << __FUNCTION__ << " ");
+
+        GfxFont* font = state->getFont();
+        bool invisible;
+        if (!font || skip_text(state, invisible)) {
+            return;
+        }
+
+        const double* ctm = state->getCTM();
+        const double* tm = state->getTextMat();
+        const double font_size = state->getFontSize();
+        const double char_space = state->getCharSpace();
+        const double word_space = state->getWordSpace();
+        const double horiz_scaling = state->getHorizScaling();
+        const bool vert_mode = (font->getWMode() != 0);
+
+        const TextMetrics metrics( state->getLeading(),
+                                   state->getRise(),
+                                   char_space,
+                                   horiz_scaling );
+
+        // char spacing is removed from the advance we report
+        double cs_dx = char_space * horiz_scaling * tm[0];
+        double cs_dy = char_space * horiz_scaling * tm[1];
+
+        // the pen position, in user space, with rise applied
+        double rise = state->getRise();
+        double cur_x = state->getCurX() + rise * tm[2];
+        double cur_y = state->getCurY() + rise * tm[3];
+
+        char* p = s->getCString();
+        int len = s->getLength();
+
+        // like Gfx, u is not reset between glyphs so it's only passed
+        // on for codes that map to unicode
+        CharCode code;
+        Unicode* u = NULL;
+        int u_len;
+
+        while (len > 0) {
+            double dx, dy, origin_x, origin_y;
+
+            int n = font->getNextChar(p, len, &code, &u, &u_len,
+                                      &dx, &dy, &origin_x, &origin_y);
+            if (n < 1) {
+                break;
+            }
+
+            // glyph advance in text space
+            bool is_space = (n == 1 && *p == ' ');
+            if (vert_mode) {
+                dx *= font_size;
+                dy = dy * font_size + char_space;
+                if (is_space) {
+                    dy += word_space;
+                }
+            } else {
+                dx = dx * font_size + char_space;
+                if (is_space) {
+                    dx += word_space;
+                }
+                dx *= horiz_scaling;
+                dy *= font_size;
+            }
+            origin_x *= font_size;
+            origin_y *= font_size;
+
+            // to user space
+            double tdx = tm[0] * dx + tm[2] * dy;
+            double tdy = tm[1] * dx + tm[3] * dy;
+            double x = cur_x - (tm[0] * origin_x + tm[2] * origin_y);
+            double y = cur_y - (tm[1] * origin_x + tm[3] * origin_y);
+
+            // and to device space
+            double x1 = ctm[0] * x + ctm[2] * y + ctm[4];
+            double y1 = ctm[1] * x + ctm[3] * y + ctm[5];
+            double adv_x = tdx - cs_dx, adv_y = tdy - cs_dy;
+            double w1 = ctm[0] * adv_x + ctm[2] * adv_y;
+            double h1 = ctm[1] * adv_x + ctm[3] * adv_y;
+
+            add_character(x1, y1, w1, h1, code, (u_len > 0 ? u : NULL), metrics, invisible);
+
+            cur_x += tdx;
+            cur_y += tdy;
+            p += n;
+            len -= n;
+        }
+    }
+
+    //
+    // new character to be 'drawn' - only used if poppler is told to
+    // via useDrawChar()
     void OutputDev::drawChar(GfxState *state, double x, double y,
                              double dx, double dy,
                              double originX, double originY,
@@ -225,15 +352,8 @@ namespace pdftoedn
     {
         DBG_TRACE_TXT(std::cerr << __FUNCTION__ << " ");
 
-        // we usually want to ignore non-marking text but some OCR'd
-        // PDFs carry text data this way so we've added an option to
-        // allow processing
-        bool invisible = (state->getRender() == util::TEXT_RENDER_INVISIBLE);
-        if (!pdftoedn::options.include_invisible_text() && invisible) {
-            return;
-        }
-
-        if (state->getStrokeColorSpace()->isNonMarking()) {
+        bool invisible;
+        if (skip_text(state, invisible)) {
             return;
         }
 
@@ -248,6 +368,39 @@ namespace pdftoedn
         dy -= dy2;
         state->transformDelta(dx, dy, &w1, &h1);
 
+        add_character( x1, y1, w1, h1, code, (uLen > 0 ? u : NULL),
+                       TextMetrics( state->getLeading(),
+                                    state->getRise(),
+                                    state->getCharSpace(),
+                                    state->getHorizScaling() ),
+                       invisible );
+    }
+
+    //
+    // checks common to all text - returns true if the text should
+    // not be processed
+    bool OutputDev::skip_text(GfxState* state, bool& invisible) const
+    {
+        // we usually want to ignore non-marking text but some OCR'd
+        // PDFs carry text data this way so we've added an option to
+        // allow processing
+        invisible = (state->getRender() == util::TEXT_RENDER_INVISIBLE);
+        if (!pdftoedn::options.include_invisible_text() && invisible) {
+            return true;
+        }
+
+        return state->getStrokeColorSpace()->isNonMarking();
+    }
+
+    //
+    // remap the character code and hand the transformed glyph to the
+    // page
+    void OutputDev::add_character(double x1, double y1, double w1, double h1,
+                                  CharCode code, Unicode* u,
+                                  const TextMetrics& metrics, bool invisible)
+    {
+        static const uint16_t UNICODE_REPLACEMENT_CHAR = 65533;
+
         // try to do any re-mapping, if applicable
         size_t glyph_idx = -1;
         uintmax_t unicode;
@@ -267,31 +420,34 @@ namespace pdftoedn
 
         switch (status) {
           case FontEngine::CODE_REMAP_IGNORE:
-          case FontEngine::CODE_REMAP_ERROR:
               return;
               break;
+          case FontEngine::CODE_REMAP_ERROR:
+              {
+                  // no unicode for this code - output its outline
+                  // instead, if the font has one
+                  bool first_use;
+                  const PdfGlyph* glyph = font_engine.get_glyph(code, first_use);
+                  if (!glyph) {
+                      return;
+                  }
+                  if (first_use) {
+                      pg_data->new_glyph(glyph);
+                  }
+                  glyph_idx = glyph->index();
+                  unicode = UNICODE_REPLACEMENT_CHAR;
+              }
+              break;
           default:
               break;
         }
 
 #ifdef ENABLE_OP_TRACE_TEXT
 #ifdef ENABLE_OP_TRACE_TEXT_VERBOSE
-        if (
-            !text_tm.is_rotated()
-            //            && string("HGMaruGothicMPRO") == state->getFont()->getName()->getCString()
-            ) {
+        if (!text_tm.is_rotated()) {
             std::cerr << "\t'"
                  << (char) code << "' (" << (int) code << "), u? " << (u != NULL ? *u : 0)
                  << ", returned unicode: '" << (char) unicode << "' (" << unicode << ") *u? " << (u?*u:0);
-                //                 << " - bbox: " << BoundingBox(x1, y1, w1, h1)
-                //                 << "\tx, y: " << x << " " << y << ", w: " << w1 << ", h: " << h1 << std::endl
-                //                 << "  state rot: " << PdfTM(state->getCTM()).rotation_deg() << "°" << std::endl
-                //                 << "  text rot:  " << PdfTM(state->getTextMat()).rotation_deg() << "°" << std::endl
-                //                 << "  rslt rot:  " << text_tm.rotation_deg() << "°"
-                //                 << ", font: " << state->getFont()->getName()->getCString()
-                //                 << ", ch sp * scaling: " << state->getCharSpace() * state->getHorizScaling()
-                //                 << ", xformed font size: " <<  state->getTransformedFontSize()
-                //                 << "\ttext CTM: " << std::endl << text_tm
         }
 #endif
         std::cerr << std::endl;
@@ -300,16 +456,12 @@ namespace pdftoedn
         // add the character
         pg_data->new_character( x1, y1, w1, h1,
                                 text_tm,
-                                TextMetrics( state->getLeading(),
-                                             state->getRise(),
-                                             state->getCharSpace(),
-                                             state->getHorizScaling() ),
+                                metrics,
                                 unicode,
                                 glyph_idx,
                                 invisible );
     }
 
-
     //
     // capture instances of the Actual Text command - these are used
     // so a PDF viewer shows different text from what's encoded. We
@@ -390,6 +542,16 @@ namespace pdftoedn
         build_path_command(state, PdfDocPath::FILL, PdfDocPath::EVEN_ODD_RULE_ENABLED);
     }
 
+    //
+    // the area painted by a shading or pattern is bound by the
+    // current clip
+    static BoundingBox state_clip_bbox(GfxState* state)
+    {
+        double x_min, y_min, x_max, y_max;
+        state->getClipBBox(&x_min, &y_min, &x_max, &y_max);
+        return BoundingBox(Coord(x_min, y_min), Coord(x_max, y_max));
+    }
+
     //
     // tiled patterns
     GBool OutputDev::tilingPatternFill(GfxState* state, Gfx* gfx, Catalog* cat, Object* str,
@@ -400,9 +562,668 @@ namespace pdftoedn
     {
         DBG_TRACE(std::cerr << __FUNCTION__ << std::endl);
 
-        // TESLA-5735 - don't do anything for now as it's not
-        // crucial. However, adding this prevents poppler from
-        // entering an infinite loop with certain docs
+        // TESLA-5735 - returning gTrue prevents poppler from
+        // replaying the tile for every repetition (and entering an
+        // infinite loop with certain docs). If not requested, the
+        // fill is skipped. Patterns used within a tile are too
+        if (!pdftoedn::options.include_tiling_patterns() || tile_depth > 0) {
+            return gTrue;
+        }
+
+        double tile_w = bbox[2] - bbox[0];
+        double tile_h = bbox[3] - bbox[1];
+        std::string key;
+        if (!(tile_w > 0 && tile_h > 0) ||
+            !tiling_pattern_key(state, str, resDict, bbox, paintType, xStep, yStep, key)) {
+            et.log_warn( ErrorTracker::ERROR_INVALID_ARGS, MODULE, "tiling pattern has no content or invalid bbox" );
+            return gTrue;
+        }
+
+        PdfTilingPattern* pattern;
+        std::map<std::string, PdfTilingPattern*>::const_iterator pi = tiling_patterns.find(key);
+        if (pi != tiling_patterns.end()) {
+            pattern = pi->second;
+        }
+        else {
+            // draw the tile's content into its own container. The
+            // form matrix undoes the current CTM and flips the bbox so
+            // the content lands y-down in tile space, like a page
+            const double* ctm = state->getCTM();
+            double det = ctm[0] * ctm[3] - ctm[1] * ctm[2];
+            if (det == 0) {
+                et.log_warn( ErrorTracker::ERROR_INVALID_ARGS, MODULE, "tiling pattern fill has a singular CTM" );
+                return gTrue;
+            }
+            double ictm[6] = { ctm[3] / det, -ctm[1] / det,
+                               -ctm[2] / det, ctm[0] / det,
+                               (ctm[2] * ctm[5] - ctm[3] * ctm[4]) / det,
+                               (ctm[1] * ctm[4] - ctm[0] * ctm[5]) / det };
+            double form_m[6] = { ictm[0], ictm[1], -ictm[2], -ictm[3],
+                                 ictm[4] - bbox[0] * ictm[0] + bbox[3] * ictm[2],
+                                 ictm[5] - bbox[0] * ictm[1] + bbox[3] * ictm[3] };
+
+            PdfPage* page = pg_data;
+            pg_data = new pdftoedn::PdfPage(0, tile_w, tile_h, 0);
+
+            ++tile_depth;
+            content_resources.push_back( ContentResources(resDict, "tile " + key) );
+            gfx->drawForm(str, resDict, form_m, bbox);
+            content_resources.pop_back();
+            --tile_depth;
+
+            pg_data->finalize();
+            pattern = new PdfTilingPattern(tiling_patterns.size(), tile_w, tile_h, xStep, yStep, pg_data);
+            tiling_patterns[key] = pattern;
+            pg_data = page;
+
+            // text in the tile changes the font engine's current font
+            if (state->getFont()) {
+                updateFont(state);
+            }
+        }
+
+        if (output_patterns.insert(pattern).second) {
+            pg_data->new_pattern(pattern);
+        }
+
+        // undo the flip and bbox offset, then mat maps pattern space
+        // to the page
+        PdfTM tile_tm(mat[0], mat[1], -mat[2], -mat[3],
+                      bbox[0] * mat[0] + bbox[3] * mat[2] + mat[4],
+                      bbox[0] * mat[1] + bbox[3] * mat[3] + mat[5]);
+
+        pg_data->new_pattern_fill( new PdfPatternFill(pattern->id(), tile_tm, state_clip_bbox(state)) );
+        return gTrue;
+    }
+
+    //
+    // tiles are cached by the MD5 of their content, the refs of the
+    // resources it can use, the tile geometry and, for uncolored
+    // patterns, the color they're painted with. Returns false if the
+    // content can't be read
+    bool OutputDev::tiling_pattern_key(GfxState* state, Object* str, Dict* resDict, const double* bbox,
+                                       int paint_type, double x_step, double y_step, std::string& key)
+    {
+        if (!str || !str->isStream()) {
+            return false;
+        }
+
+        // decoding and hashing the content on every fill is what the
+        // cache is meant to avoid. A stream read from the file is
+        // identified by its position so its MD5 is computed once
+        Stream* s = str->getStream();
+        BaseStream* base = s->getBaseStream();
+        bool in_file = (base && (base->getKind() == strFile || base->getKind() == strCachedFile));
+        std::pair<Goffset, Goffset> file_pos;
+        std::string content_md5;
+
+        if (in_file) {
+            file_pos = std::make_pair(base->getStart(), base->getLength());
+            std::map<std::pair<Goffset, Goffset>, std::string>::const_iterator mi = tile_content_md5s.find(file_pos);
+            if (mi != tile_content_md5s.end()) {
+                content_md5 = mi->second;
+            }
+        }
+
+        if (content_md5.empty()) {
+            std::string content;
+            s->reset();
+            int c;
+            while ((c = s->getChar()) != EOF) {
+                content.push_back(static_cast<char>(c));
+            }
+            s->close();
+
+            content_md5 = util::md5(content);
+            if (in_file) {
+                tile_content_md5s[file_pos] = content_md5;
+            }
+        }
+
+        std::ostringstream key_s;
+        key_s << content_md5 << ' '
+              << bbox[0] << ' ' << bbox[1] << ' ' << bbox[2] << ' ' << bbox[3] << ' '
+              << x_step << ' ' << y_step;
+
+        // resources are dicts of dicts (fonts, xobjects, etc.)
+        if (resDict) {
+            for (int i = 0; i < resDict->getLength(); ++i) {
+                Object category;
+                if (resDict->getVal(i, &category)->isDict()) {
+                    Dict* d = category.getDict();
+                    for (int j = 0; j < d->getLength(); ++j) {
+                        Object entry;
+                        if (d->getValNF(j, &entry)->isRef()) {
+                            key_s << ' ' << resDict->getKey(i) << '/' << d->getKey(j) << '='
+                                  << entry.getRef().num << '.' << entry.getRef().gen;
+                        }
+                        entry.free();
+                    }
+                }
+                category.free();
+            }
+        }
+
+        if (paint_type == 2) {
+            GfxRGB rgb;
+            state->getFillRGB(&rgb);
+            key_s << ' ' << rgb.r << ' ' << rgb.g << ' ' << rgb.b;
+        }
+
+        key = key_s.str();
+        return true;
+    }
+
+    //
+    // form XObjects are interpreted once and placed by reference if
+    // enabled
+    GBool OutputDev::useDrawForm()
+    {
+        return pdftoedn::options.cache_forms();
+    }
+
+    //
+    // a form inherits the graphics state it's drawn with: colors,
+    // opacities and blend mode, line and text state. The CTM and clip
+    // are applied when it's placed
+    static void inherit_form_state(GfxState* outer, GfxState* st)
+    {
+        st->setFillColorSpace(outer->getFillColorSpace()->copy());
+        st->setStrokeColorSpace(outer->getStrokeColorSpace()->copy());
+        st->setFillColor(outer->getFillColor());
+        st->setStrokeColor(outer->getStrokeColor());
+        if (outer->getFillPattern()) {
+            st->setFillPattern(outer->getFillPattern()->copy());
+        }
+        if (outer->getStrokePattern()) {
+            st->setStrokePattern(outer->getStrokePattern()->copy());
+        }
+        st->setFillOpacity(outer->getFillOpacity());
+        st->setStrokeOpacity(outer->getStrokeOpacity());
+        st->setBlendMode(outer->getBlendMode());
+        st->setFillOverprint(outer->getFillOverprint());
+        st->setStrokeOverprint(outer->getStrokeOverprint());
+        st->setOverprintMode(outer->getOverprintMode());
+
+        st->setLineWidth(outer->getLineWidth());
+        double* dash;
+        int dash_len;
+        double dash_start;
+        outer->getLineDash(&dash, &dash_len, &dash_start);
+        double* dash_copy = NULL;
+        if (dash_len > 0) {
+            // the state takes ownership of the array
+            dash_copy = static_cast<double*>(gmallocn(dash_len, sizeof(double)));
+            std::copy(dash, dash + dash_len, dash_copy);
+        }
+        st->setLineDash(dash_copy, dash_len, dash_start);
+        st->setLineCap(outer->getLineCap());
+        st->setLineJoin(outer->getLineJoin());
+        st->setMiterLimit(outer->getMiterLimit());
+        st->setFlatness(outer->getFlatness());
+        st->setStrokeAdjust(outer->getStrokeAdjust());
+        st->setAlphaIsShape(outer->getAlphaIsShape());
+        st->setTextKnockout(outer->getTextKnockout());
+
+        if (outer->getFont()) {
+            outer->getFont()->incRefCnt();
+            st->setFont(outer->getFont(), outer->getFontSize());
+        }
+        st->setCharSpace(outer->getCharSpace());
+        st->setWordSpace(outer->getWordSpace());
+        st->setHorizScaling(outer->getHorizScaling());
+        st->setLeading(outer->getLeading());
+        st->setRise(outer->getRise());
+        st->setRender(outer->getRender());
+    }
+
+    //
+    // writes the state inherit_form_state() copies
+    static void form_state_key(GfxState* st, std::ostream& key_s)
+    {
+        GfxRGB fill, stroke;
+        st->getFillRGB(&fill);
+        st->getStrokeRGB(&stroke);
+        key_s << ' ' << st->getFillColorSpace()->getMode() << ' ' << fill.r << ' ' << fill.g << ' ' << fill.b
+              << ' ' << st->getStrokeColorSpace()->getMode() << ' ' << stroke.r << ' ' << stroke.g << ' ' << stroke.b
+              << ' ' << st->getFillOpacity() << ' ' << st->getStrokeOpacity() << ' ' << st->getBlendMode()
+              << ' ' << st->getFillOverprint() << ' ' << st->getStrokeOverprint() << ' ' << st->getOverprintMode();
+
+        double* dash;
+        int dash_len;
+        double dash_start;
+        st->getLineDash(&dash, &dash_len, &dash_start);
+        key_s << ' ' << st->getLineWidth() << " [";
+        for (int i = 0; i < dash_len; ++i) {
+            key_s << ' ' << dash[i];
+        }
+        key_s << " ] " << dash_start
+              << ' ' << st->getLineCap() << ' ' << st->getLineJoin() << ' ' << st->getMiterLimit()
+              << ' ' << st->getFlatness() << ' ' << st->getStrokeAdjust()
+              << ' ' << st->getAlphaIsShape() << ' ' << st->getTextKnockout();
+
+        GfxFont* font = st->getFont();
+        if (font) {
+            key_s << ' ' << font->getID()->num << '.' << font->getID()->gen
+                  << ' ' << st->getFontSize();
+        }
+        key_s << ' ' << st->getCharSpace() << ' ' << st->getWordSpace() << ' ' << st->getHorizScaling()
+              << ' ' << st->getLeading() << ' ' << st->getRise() << ' ' << st->getRender();
+    }
+
+    //
+    // a form is reused only with the same inherited state and, if it
+    // has no resources of its own, the same parent resources as its
+    // content may depend on them
+    void OutputDev::drawForm(Ref id)
+    {
+        DBG_TRACE(std::cerr << __FUNCTION__ << " " << id.num << " " << id.gen << std::endl);
+
+        if (!cur_state || forms_drawing.find(id.num) != forms_drawing.end()) {
+            et.log_warn( ErrorTracker::ERROR_INVALID_ARGS, MODULE, "form XObject drawn with no state or recursively" );
+            return;
+        }
+
+        std::ostringstream key_s;
+        key_s << id.num << '.' << id.gen;
+        form_state_key(cur_state, key_s);
+
+        // pattern colors can't be compared so forms painted with
+        // them are not reused
+        if (cur_state->getFillColorSpace()->getMode() == csPattern ||
+            cur_state->getStrokeColorSpace()->getMode() == csPattern) {
+            key_s << " pattern " << forms.size();
+        }
+
+        if (!form_has_resources(id)) {
+            key_s << " res " << (content_resources.empty() ? "page" : content_resources.back().key);
+            if (content_resources.empty()) {
+                key_s << ' ' << cur_page_num;
+            }
+        }
+        std::string key = key_s.str();
+
+        PdfForm* form;
+        std::map<std::string, PdfForm*>::const_iterator fi = forms.find(key);
+        if (fi != forms.end()) {
+            form = fi->second;
+        }
+        else {
+            form = read_form(id);
+            if (!form) {
+                return;
+            }
+            forms[key] = form;
+        }
+
+        if (output_forms.insert(form).second) {
+            pg_data->new_form(form);
+        }
+
+        // form space -> page
+        const PdfTM& f = form->form_tm();
+        const double* ctm = cur_state->getCTM();
+        PdfTM tm(f.a() * ctm[0] + f.b() * ctm[2],
+                 f.a() * ctm[1] + f.b() * ctm[3],
+                 f.c() * ctm[0] + f.d() * ctm[2],
+                 f.c() * ctm[1] + f.d() * ctm[3],
+                 f.e() * ctm[0] + f.f() * ctm[2] + ctm[4],
+                 f.e() * ctm[1] + f.f() * ctm[3] + ctm[5]);
+
+        // bounds of the placed bbox
+        const BoundingBox& form_bbox = form->bounding_box();
+        Bounds bounds;
+        const double corners[4][2] = { { form_bbox.x_min(), form_bbox.y_min() },
+                                       { form_bbox.x_max(), form_bbox.y_min() },
+                                       { form_bbox.x_max(), form_bbox.y_max() },
+                                       { form_bbox.x_min(), form_bbox.y_max() } };
+        for (const double* c : corners) {
+            bounds.expand(tm.transform(Coord(c[0], c[1])));
+        }
+
+        pg_data->new_form_instance( new PdfFormInstance(form->id(), tm, bounds.bounding_box()) );
+    }
+
+    //
+    // interpret a form's content into its own container with a
+    // sub-interpreter that inherits the current state. Returns NULL
+    // if the form can't be read
+    PdfForm* OutputDev::read_form(Ref id)
+    {
+        Object obj;
+        if (!doc->getXRef()->fetch(id.num, id.gen, &obj)->isStream()) {
+            et.log_error( ErrorTracker::ERROR_INVALID_ARGS, MODULE, "form XObject is not a stream" );
+            obj.free();
+            return NULL;
+        }
+
+        Dict* dict = obj.streamGetDict();
+
+        double bbox[4];
+        Object bbox_obj;
+        if (!dict->lookup("BBox", &bbox_obj)->isArray() || bbox_obj.arrayGetLength() != 4) {
+            et.log_error( ErrorTracker::ERROR_INVALID_ARGS, MODULE, "form XObject has invalid bbox" );
+            bbox_obj.free();
+            obj.free();
+            return NULL;
+        }
+        for (int i = 0; i < 4; ++i) {
+            Object n;
+            bbox[i] = (bbox_obj.arrayGet(i, &n)->isNum() ? n.getNum() : 0);
+            n.free();
+        }
+        bbox_obj.free();
+        if (bbox[0] > bbox[2]) { std::swap(bbox[0], bbox[2]); }
+        if (bbox[1] > bbox[3]) { std::swap(bbox[1], bbox[3]); }
+
+        double matrix[6] = { 1, 0, 0, 1, 0, 0 };
+        Object matrix_obj;
+        if (dict->lookup("Matrix", &matrix_obj)->isArray() && matrix_obj.arrayGetLength() == 6) {
+            for (int i = 0; i < 6; ++i) {
+                Object n;
+                if (matrix_obj.arrayGet(i, &n)->isNum()) {
+                    matrix[i] = n.getNum();
+                }
+                n.free();
+            }
+        }
+        matrix_obj.free();
+
+        // forms without resources use their parent's: the form or
+        // tile being read or the page
+        Object res_obj;
+        Dict* res = NULL;
+        if (dict->lookup("Resources", &res_obj)->isDict()) {
+            res = res_obj.getDict();
+        }
+        else if (!content_resources.empty()) {
+            res = content_resources.back().dict;
+        }
+        else if (cur_page_num > 0) {
+            res = catalog->getPage(cur_page_num)->getResourceDict();
+        }
+
+        double form_w = bbox[2] - bbox[0];
+        double form_h = bbox[3] - bbox[1];
+
+        // the content is drawn y-down like a page, with the origin at
+        // the bbox's top-left corner
+        PDFRectangle box = { 0, 0, form_w, form_h };
+        Gfx* gfx = new Gfx(doc, this, res, &box, NULL);
+
+        GfxState* outer = cur_state;
+        GfxState* st = gfx->getState();
+        inherit_form_state(outer, st);
+
+        PdfPage* page = pg_data;
+        pg_data = new pdftoedn::PdfPage(0, form_w, form_h, 0);
+        updateAll(st);
+
+        // the sub-interpreter's state is y-up so the form matrix
+        // flips the bbox
+        double form_m[6] = { 1, 0, 0, -1, -bbox[0], bbox[3] };
+        std::ostringstream res_key;
+        res_key << "form " << id.num << '.' << id.gen;
+        content_resources.push_back( ContentResources(res, res_key.str()) );
+        forms_drawing.insert(id.num);
+        gfx->drawForm(&obj, res, form_m, bbox);
+        forms_drawing.erase(id.num);
+        content_resources.pop_back();
+        delete gfx;
+
+        pg_data->finalize();
+
+        // undo the flip and bbox offset, then the form's matrix
+        PdfTM form_tm(matrix[0], matrix[1], -matrix[2], -matrix[3],
+                      bbox[0] * matrix[0] + bbox[3] * matrix[2] + matrix[4],
+                      bbox[0] * matrix[1] + bbox[3] * matrix[3] + matrix[5]);
+        PdfForm* form = new PdfForm(forms.size(), form_w, form_h, form_tm, pg_data);
+
+        pg_data = page;
+        cur_state = outer;
+
+        // text in the form changes the font engine's current font
+        if (outer->getFont()) {
+            updateFont(outer);
+        }
+
+        res_obj.free();
+        obj.free();
+        return form;
+    }
+
+    //
+    // checks once per form if it carries its own resources
+    bool OutputDev::form_has_resources(Ref id)
+    {
+        std::map<int, bool>::const_iterator ri = forms_with_resources.find(id.num);
+        if (ri != forms_with_resources.end()) {
+            return ri->second;
+        }
+
+        bool has_res = false;
+        Object obj;
+        if (doc->getXRef()->fetch(id.num, id.gen, &obj)->isStream()) {
+            Object res_obj;
+            has_res = obj.streamGetDict()->lookup("Resources", &res_obj)->isDict();
+            res_obj.free();
+        }
+        obj.free();
+
+        forms_with_resources[id.num] = has_res;
+        return has_res;
+    }
+
+    //
+    // smooth shadings. Types 1 - 5 are output as descriptors if
+    // enabled; poppler subdivides the rest (and all of them
+    // otherwise) into fills
+    GBool OutputDev::useShadedFills(int type)
+    {
+        return (pdftoedn::options.native_shading() && type >= 1 && type <= 5);
+    }
+
+    // stop offsets are sampled at this resolution over the shading's
+    // domain; max. per-component difference (in 0..255 units) for
+    // sampled colors to be reproduced by interpolating between stops
+    static const uintmax_t SHADING_NUM_SAMPLES = 256;
+    static const double SHADING_COLOR_TOLERANCE = 1.0;
+
+    //
+    // returns the index of a shading color in the page's table
+    uintmax_t OutputDev::register_shading_color(GfxColorSpace* color_space, GfxColor* color)
+    {
+        GfxRGB rgb;
+        color_space->getRGB(color, &rgb);
+        return pg_data->register_color(rgb.r, rgb.g, rgb.b);
+    }
+
+    //
+    // sample the shading's color function over its domain and keep
+    // only the stops needed to reproduce every sample (within the
+    // tolerance) by linear interpolation
+    void OutputDev::sample_shading_stops(GfxUnivariateShading* shading, PdfShading& edsel_shading)
+    {
+        double t0 = shading->getDomain0();
+        double t1 = shading->getDomain1();
+        GfxColorSpace* color_space = shading->getColorSpace();
+
+        std::vector<GfxColor> colors(SHADING_NUM_SAMPLES + 1);
+        std::vector<double> rgb(3 * (SHADING_NUM_SAMPLES + 1));
+        for (uintmax_t i = 0; i <= SHADING_NUM_SAMPLES; ++i) {
+            shading->getColor(t0 + (t1 - t0) * i / SHADING_NUM_SAMPLES, &colors[i]);
+
+            GfxRGB c;
+            color_space->getRGB(&colors[i], &c);
+            rgb[3 * i]     = colToDbl(c.r) * 255;
+            rgb[3 * i + 1] = colToDbl(c.g) * 255;
+            rgb[3 * i + 2] = colToDbl(c.b) * 255;
+        }
+
+        // can samples between s1 and s2 be interpolated from them?
+        auto interpolates = [&](uintmax_t s1, uintmax_t s2) {
+            for (uintmax_t s = s1 + 1; s < s2; ++s) {
+                double f = double(s - s1) / (s2 - s1);
+                for (uintmax_t c = 0; c < 3; ++c) {
+                    double v = rgb[3 * s1 + c] + (rgb[3 * s2 + c] - rgb[3 * s1 + c]) * f;
+                    if (std::abs(v - rgb[3 * s + c]) > SHADING_COLOR_TOLERANCE) {
+                        return false;
+                    }
+                }
+            }
+            return true;
+        };
+
+        edsel_shading.add_stop(0, register_shading_color(color_space, &colors[0]));
+
+        uintmax_t s1 = 0;
+        while (s1 < SHADING_NUM_SAMPLES) {
+            uintmax_t s2 = s1 + 1;
+            while (s2 < SHADING_NUM_SAMPLES && interpolates(s1, s2 + 1)) {
+                ++s2;
+            }
+            edsel_shading.add_stop(double(s2) / SHADING_NUM_SAMPLES,
+                                   register_shading_color(color_space, &colors[s2]));
+            s1 = s2;
+        }
+    }
+
+    //
+    // type 1 - colors are sampled on a grid over the domain
+    GBool OutputDev::functionShadedFill(GfxState *state, GfxFunctionShading *shading)
+    {
+        DBG_TRACE(std::cerr << __FUNCTION__ << std::endl);
+
+        // the domain is mapped to user space by the shading's matrix
+        const double* m = shading->getMatrix();
+        const double* ctm = state->getCTM();
+        PdfTM tm(m[0] * ctm[0] + m[1] * ctm[2],
+                 m[0] * ctm[1] + m[1] * ctm[3],
+                 m[2] * ctm[0] + m[3] * ctm[2],
+                 m[2] * ctm[1] + m[3] * ctm[3],
+                 m[4] * ctm[0] + m[5] * ctm[2] + ctm[4],
+                 m[4] * ctm[1] + m[5] * ctm[3] + ctm[5]);
+
+        PdfShading* edsel_shading = new PdfShading(PdfShading::FUNCTION, tm, state_clip_bbox(state),
+                                                   state->getFillOpacity());
+        double x0, y0, x1, y1;
+        shading->getDomain(&x0, &y0, &x1, &y1);
+        edsel_shading->add_coord(x0);
+        edsel_shading->add_coord(y0);
+        edsel_shading->add_coord(x1);
+        edsel_shading->add_coord(y1);
+
+        // sample at the center of each cell
+        const uintmax_t grid_size = PdfShading::FUNCTION_GRID_SIZE;
+        for (uintmax_t r = 0; r < grid_size; ++r) {
+            double y = y0 + (y1 - y0) * (r + 0.5) / grid_size;
+            for (uintmax_t c = 0; c < grid_size; ++c) {
+                GfxColor color;
+                shading->getColor(x0 + (x1 - x0) * (c + 0.5) / grid_size, y, &color);
+                edsel_shading->add_color(register_shading_color(shading->getColorSpace(), &color));
+            }
+        }
+
+        pg_data->new_shading(edsel_shading);
+        return gTrue;
+    }
+
+    //
+    // type 2
+    GBool OutputDev::axialShadedFill(GfxState *state, GfxAxialShading *shading, double tMin, double tMax)
+    {
+        DBG_TRACE(std::cerr << __FUNCTION__ << std::endl);
+
+        PdfShading* edsel_shading = new PdfShading(PdfShading::AXIAL, PdfTM(state->getCTM()),
+                                                   state_clip_bbox(state), state->getFillOpacity());
+        double x0, y0, x1, y1;
+        shading->getCoords(&x0, &y0, &x1, &y1);
+        edsel_shading->add_coord(x0);
+        edsel_shading->add_coord(y0);
+        edsel_shading->add_coord(x1);
+        edsel_shading->add_coord(y1);
+        edsel_shading->set_extend(shading->getExtend0(), shading->getExtend1());
+
+        sample_shading_stops(shading, *edsel_shading);
+
+        pg_data->new_shading(edsel_shading);
+        return gTrue;
+    }
+
+    //
+    // type 3
+    GBool OutputDev::radialShadedFill(GfxState *state, GfxRadialShading *shading, double sMin, double sMax)
+    {
+        DBG_TRACE(std::cerr << __FUNCTION__ << std::endl);
+
+        PdfShading* edsel_shading = new PdfShading(PdfShading::RADIAL, PdfTM(state->getCTM()),
+                                                   state_clip_bbox(state), state->getFillOpacity());
+        double x0, y0, r0, x1, y1, r1;
+        shading->getCoords(&x0, &y0, &r0, &x1, &y1, &r1);
+        edsel_shading->add_coord(x0);
+        edsel_shading->add_coord(y0);
+        edsel_shading->add_coord(r0);
+        edsel_shading->add_coord(x1);
+        edsel_shading->add_coord(y1);
+        edsel_shading->add_coord(r1);
+        edsel_shading->set_extend(shading->getExtend0(), shading->getExtend1());
+
+        sample_shading_stops(shading, *edsel_shading);
+
+        pg_data->new_shading(edsel_shading);
+        return gTrue;
+    }
+
+    //
+    // types 4 & 5 - free-form and lattice-form triangle meshes
+    GBool OutputDev::gouraudTriangleShadedFill(GfxState *state, GfxGouraudTriangleShading *shading)
+    {
+        DBG_TRACE(std::cerr << __FUNCTION__ << std::endl);
+
+        PdfTM ctm(state->getCTM());
+        GfxColorSpace* color_space = shading->getColorSpace();
+
+        // the painted area is bound by the mesh itself
+        Bounds mesh_bounds;
+        double x[3], y[3];
+        GfxColor colors[3];
+        std::vector<double> coords;
+        std::vector<uintmax_t> color_indices;
+
+        for (int i = 0; i < shading->getNTriangles(); ++i) {
+            if (shading->isParameterized()) {
+                double t[3];
+                shading->getTriangle(i, &x[0], &y[0], &t[0], &x[1], &y[1], &t[1], &x[2], &y[2], &t[2]);
+                for (uintmax_t v = 0; v < 3; ++v) {
+                    shading->getParameterizedColor(t[v], &colors[v]);
+                }
+            } else {
+                shading->getTriangle(i, &x[0], &y[0], &colors[0], &x[1], &y[1], &colors[1],
+                                     &x[2], &y[2], &colors[2]);
+            }
+
+            for (uintmax_t v = 0; v < 3; ++v) {
+                coords.push_back(x[v]);
+                coords.push_back(y[v]);
+                color_indices.push_back(register_shading_color(color_space, &colors[v]));
+                mesh_bounds.expand(ctm.transform(Coord(x[v], y[v])));
+            }
+        }
+
+        if (color_indices.empty()) {
+            return gTrue;
+        }
+
+        BoundingBox bbox = mesh_bounds.bounding_box().clip(state_clip_bbox(state));
+        PdfShading* edsel_shading = new PdfShading(PdfShading::TRIANGLES, ctm, bbox,
+                                                   state->getFillOpacity());
+        for (uintmax_t v = 0; v < color_indices.size(); ++v) {
+            edsel_shading->add_coord(coords[v * 2]);
+            edsel_shading->add_coord(coords[v * 2 + 1]);
+            edsel_shading->add_color(color_indices[v]);
+        }
+
+        pg_data->new_shading(edsel_shading);
         return gTrue;
     }
 
@@ -479,6 +1300,11 @@ namespace pdftoedn
 
         BoundingBox bbox(ctm);
 
+        // don't decode images that can't be seen
+        if (!pg_data->is_visible(bbox)) {
+            return;
+        }
+
         // lookup the object id to see if we've cached it already -
         // inlined images don't have a ref_num so we stream must be
         // extracted anyway and the md5 can be used to determine if
@@ -563,6 +1389,11 @@ namespace pdftoedn
 
         BoundingBox bbox(ctm);
 
+        // don't decode images that can't be seen
+        if (!pg_data->is_visible(bbox)) {
+            return;
+        }
+
         // lookup the object id to see if we've cached it already
         if (!pg_data->image_is_cached(ref_num))
         {
@@ -663,6 +1494,11 @@ namespace pdftoedn
 
         BoundingBox bbox(ctm);
 
+        // don't decode images that can't be seen
+        if (!pg_data->is_visible(bbox)) {
+            return;
+        }
+
         // lookup the object id to see if we've cached it already
         if (!pg_data->image_is_cached(ref_num))
         {
@@ -746,6 +1582,11 @@ namespace pdftoedn
 
         BoundingBox bbox(ctm);
 
+        // don't decode images that can't be seen
+        if (!pg_data->is_visible(bbox)) {
+            return;
+        }
+
         // lookup the object id to see if we've cached it already -
         // inlined images don't have a ref_num so we stream must be
         // extracted anyway and the md5 can be used to determine if
@@ -842,6 +1683,7 @@ namespace pdftoedn
     // gfx state update methods
     void OutputDev::updateAll(GfxState *state)
     {
+        cur_state = state;
         ::OutputDev::updateAll(state);
 
         DBG_TRACE(std::cerr << " + ---- " << __FUNCTION__ << " ---- + " << std::endl);
@@ -854,6 +1696,7 @@ namespace pdftoedn
     // line-dashes
     void OutputDev::updateLineDash(GfxState* state)
     {
+        cur_state = state;
         DBG_TRACE(std::cerr << " + ---- " << __FUNCTION__ << " ---- + " << std::endl);
 
         // line dash pattern
@@ -890,6 +1733,7 @@ namespace pdftoedn
     // line join style
     void OutputDev::updateLineJoin(GfxState *state)
     {
+        cur_state = state;
         DBG_TRACE(std::cerr << " + ---- " << __FUNCTION__ << ": " << state->getLineJoin() << " ---- + " << std::endl);
 
         pg_data->update_line_join(state->getLineJoin());
@@ -899,6 +1743,7 @@ namespace pdftoedn
     // line cap style
     void OutputDev::updateLineCap(GfxState *state)
     {
+        cur_state = state;
         DBG_TRACE(std::cerr << " + ---- " << __FUNCTION__ << ": " << state->getLineCap() << " ---- + " << std::endl);
 
         pg_data->update_line_cap(state->getLineCap());
@@ -908,6 +1753,7 @@ namespace pdftoedn
     // miter limit
     void OutputDev::updateMiterLimit(GfxState *state)
     {
+        cur_state = state;
         DBG_TRACE(std::cerr << " + ---- " << __FUNCTION__ << ": " << state->getMiterLimit() << " ---- + " << std::endl);
 
         pg_data->update_miter_limit(state->getMiterLimit());
@@ -917,6 +1763,7 @@ namespace pdftoedn
     // line width
     void OutputDev::updateLineWidth(GfxState *state)
     {
+        cur_state = state;
         DBG_TRACE(std::cerr << " + ---- " << __FUNCTION__ << ": SA? " << std::boolalpha << state->getStrokeAdjust()
                             << ", state LW: " << state->getLineWidth()
                             << " ---- + " << std::endl);
@@ -928,6 +1775,7 @@ namespace pdftoedn
     // is soft mask shape / alpha interpreted as shape or opacity?
     void OutputDev::updateAlphaIsShape(GfxState *state)
     {
+        cur_state = state;
         DBG_TRACE(std::cerr << " + ---- " << __FUNCTION__ << ": " << std::boolalpha << state->getAlphaIsShape() << " ---- + " << std::endl);
 
         if (state->getAlphaIsShape()) {
@@ -941,6 +1789,7 @@ namespace pdftoedn
     // does text knock out overlapping glyphs
     void OutputDev::updateTextKnockout(GfxState *state)
     {
+        cur_state = state;
         DBG_TRACE(std::cerr << " + ---- " << __FUNCTION__ << ": " << std::boolalpha << state->getTextKnockout() << " ---- + " << std::endl);
 
         std::stringstream err;
@@ -952,6 +1801,7 @@ namespace pdftoedn
     // fill color
     void OutputDev::updateFillColor(GfxState *state)
     {
+        cur_state = state;
         GfxRGB rgb;
         state->getFillRGB(&rgb);
 
@@ -964,6 +1814,7 @@ namespace pdftoedn
     // stroke
     void OutputDev::updateStrokeColor(GfxState *state)
     {
+        cur_state = state;
         GfxRGB rgb;
         state->getStrokeRGB(&rgb);
 
@@ -975,6 +1826,7 @@ namespace pdftoedn
 
     void OutputDev::updateBlendMode(GfxState *state)
     {
+        cur_state = state;
         DBG_TRACE(std::cerr << " + ---- " << __FUNCTION__ << ": " << util::debug::get_blend_mode_str(state->getBlendMode()) << " ---- + " << std::endl);
 
         pg_data->update_blend_mode(util::pdf_to_svg_blend_mode(state->getBlendMode()));
@@ -982,6 +1834,7 @@ namespace pdftoedn
 
     void OutputDev::updateFillOpacity(GfxState *state)
     {
+        cur_state = state;
         DBG_TRACE(std::cerr << " + ---- " << __FUNCTION__ << ": " << state->getFillOpacity() << " ---- + " << std::endl);
 
         pg_data->update_fill_opacity(state->getFillOpacity());
@@ -989,6 +1842,7 @@ namespace pdftoedn
 
     void OutputDev::updateStrokeOpacity(GfxState *state)
     {
+        cur_state = state;
         DBG_TRACE(std::cerr << " + ---- " << __FUNCTION__  << ": " << state->getStrokeOpacity() << " ---- + " << std::endl);
 
         pg_data->update_stroke_opacity(state->getStrokeOpacity());
@@ -996,6 +1850,7 @@ namespace pdftoedn
 
     void OutputDev::updateFillOverprint(GfxState *state)
     {
+        cur_state = state;
         DBG_TRACE(std::cerr << " + ---- " << __FUNCTION__ << ": " << state->getFillOverprint() << " ---- + " << std::endl);
 
         pg_data->update_fill_overprint(state->getFillOverprint());
@@ -1003,6 +1858,7 @@ namespace pdftoedn
 
     void OutputDev::updateStrokeOverprint(GfxState *state)
     {
+        cur_state = state;
         DBG_TRACE(std::cerr << " + ---- " << __FUNCTION__ << ": " << state->getStrokeOverprint() << " ---- + " << std::endl);
 
         pg_data->update_stroke_overprint(state->getStrokeOverprint());
@@ -1010,6 +1866,7 @@ namespace pdftoedn
 
     void OutputDev::updateOverprintMode(GfxState *state)
     {
+        cur_state = state;
         DBG_TRACE(std::cerr << " + ---- " << __FUNCTION__ << ": " << state->getOverprintMode() << " ---- + " << std::endl);
 
         pg_data->update_overprint_mode(state->getOverprintMode());
@@ -22,17 +22,26 @@
 #pragma interface
 #endif
 
+#include <map>
 #include <queue>
+#include <set>
+#include <string>
+#include <vector>
 
 #include <poppler/GfxState.h>
+#include <poppler/PDFDoc.h>
 
 #include "eng_output_dev.h"
 #include "graphics.h"
+#include "shading.h"
+#include "pattern.h"
+#include "form.h"
 
 namespace pdftoedn
 {
     class FontEngine;
     class StreamProps;
+    struct TextMetrics;
 
     //------------------------------------------------------------------------
     // pdftoedn::OutputDev
@@ -44,12 +53,16 @@ namespace pdftoedn
 
         // constructor takes reference to object that will store
         // extracted data
-        OutputDev(Catalog* doc_cat, pdftoedn::FontEngine& fnt_engine) :
-            EngOutputDev(doc_cat),
+        OutputDev(PDFDoc* pdf_doc, pdftoedn::FontEngine& fnt_engine) :
+            EngOutputDev(pdf_doc->getCatalog()),
+            doc(pdf_doc),
             font_engine(fnt_engine),
-            inline_img_id(IMG_RES_ID_UNDEF - 1)
+            inline_img_id(IMG_RES_ID_UNDEF - 1),
+            tile_depth(0),
+            cur_state(NULL),
+            cur_page_num(0)
         { }
-        virtual ~OutputDev() { }
+        virtual ~OutputDev();
 
         // set up font manager, etc.
         bool init();
@@ -63,8 +76,10 @@ namespace pdftoedn
         virtual GBool needNonText() { return gTrue; }
         virtual GBool needCharCount() { return gTrue; }
 
-        // Does this device use drawChar() or drawString()?
-        virtual GBool useDrawChar() { return gTrue; }
+        // Does this device use drawChar() or drawString()? We walk
+        // the glyphs of each string ourselves so the text state is
+        // only read once per show operator
+        virtual GBool useDrawChar() { return gFalse; }
 
         virtual GBool useTilingPatternFill() { return gTrue; }
 
@@ -82,20 +97,23 @@ namespace pdftoedn
         virtual void endPage();
 
         //----- update graphics state
+        virtual void updateCTM(GfxState *state, double m11, double m12,
+                               double m21, double m22, double m31, double m32);
         virtual void saveState(GfxState* state);
         virtual void restoreState(GfxState* state);
 
         virtual void updateAll(GfxState *state);
         virtual void updateLineDash(GfxState* state);
-        virtual void updateFlatness(GfxState * /*state*/) {}
+        virtual void updateFlatness(GfxState *state) { cur_state = state; }
         virtual void updateLineJoin(GfxState *state);
         virtual void updateLineCap(GfxState *state);
         virtual void updateMiterLimit(GfxState *state);
         virtual void updateLineWidth(GfxState *state);
         virtual void updateAlphaIsShape(GfxState *state);
         virtual void updateTextKnockout(GfxState *state);
-        virtual void updateFillColorSpace(GfxState * /*state*/) {}
-        virtual void updateStrokeColorSpace(GfxState * /*state*/) {}
+        virtual void updateStrokeAdjust(GfxState *state) { cur_state = state; }
+        virtual void updateFillColorSpace(GfxState *state) { cur_state = state; }
+        virtual void updateStrokeColorSpace(GfxState *state) { cur_state = state; }
         virtual void updateFillColor(GfxState *state);
         virtual void updateStrokeColor(GfxState *state);
         virtual void updateBlendMode(GfxState *state);
@@ -109,9 +127,19 @@ namespace pdftoedn
 
         //----- text state
         virtual void updateFont(GfxState* state);
+        virtual void updateTextMat(GfxState* state) { cur_state = state; }
+        virtual void updateCharSpace(GfxState* state) { cur_state = state; }
+        virtual void updateRender(GfxState* state) { cur_state = state; }
+        virtual void updateRise(GfxState* state) { cur_state = state; }
+        virtual void updateWordSpace(GfxState* state) { cur_state = state; }
+        virtual void updateHorizScaling(GfxState* state) { cur_state = state; }
+        virtual void updateTextPos(GfxState* state) { cur_state = state; }
         virtual void updateTextShift(GfxState* state, double shift);
 
         //----- text drawing
+        virtual void beginString(GfxState * /*state*/, GooString * /*s*/) {}
+        virtual void endString(GfxState * /*state*/) {}
+        virtual void drawString(GfxState *state, GooString *s);
         virtual void drawChar(GfxState *state, double x, double y,
                               double dx, double dy,
                               double originX, double originY,
@@ -131,6 +159,23 @@ namespace pdftoedn
                                         int /*x0*/, int /*y0*/, int /*x1*/, int /*y1*/,
                                         double /*xStep*/, double /*yStep*/);
 
+        // tiling patterns and forms are cached for the whole document
+        virtual void reset_resource_output() {
+            output_patterns.clear();
+            output_forms.clear();
+        }
+
+        //----- forms (when enabled)
+        virtual GBool useDrawForm();
+        virtual void drawForm(Ref id);
+
+        //----- shadings (when enabled; patch meshes are left to poppler)
+        virtual GBool useShadedFills(int type);
+        virtual GBool functionShadedFill(GfxState *state, GfxFunctionShading *shading);
+        virtual GBool axialShadedFill(GfxState *state, GfxAxialShading *shading, double tMin, double tMax);
+        virtual GBool radialShadedFill(GfxState *state, GfxRadialShading *shading, double sMin, double sMax);
+        virtual GBool gouraudTriangleShadedFill(GfxState *state, GfxGouraudTriangleShading *shading);
+
         //----- clipping
         virtual void clip(GfxState *state);
         virtual void eoClip(GfxState *state);
@@ -182,18 +227,60 @@ namespace pdftoedn
         virtual void clearSoftMask(GfxState * /*state*/);
 
     private:
+        PDFDoc* doc;
         pdftoedn::FontEngine& font_engine;
         PdfTM text_tm;
         std::queue<Unicode> actual_text;
         int inline_img_id;
 
+        // tiling pattern tiles by content key; the ones already output
+        std::map<std::string, PdfTilingPattern*> tiling_patterns;
+        std::set<const PdfTilingPattern*> output_patterns;
+        // MD5 of tile content streams by position in the file
+        std::map<std::pair<Goffset, Goffset>, std::string> tile_content_md5s;
+        uintmax_t tile_depth;
+
+        // forms by ref and inherited state; the ones already output
+        // and the ones being read (by ref num)
+        std::map<std::string, PdfForm*> forms;
+        std::set<const PdfForm*> output_forms;
+        std::set<int> forms_drawing;
+        std::map<int, bool> forms_with_resources;
+
+        // resources of the forms and tiles being read, innermost
+        // last, with a key identifying them. Forms without their own
+        // use these
+        struct ContentResources {
+            ContentResources(Dict* d, const std::string& k) : dict(d), key(k) {}
+            Dict* dict;
+            std::string key;
+        };
+        std::vector<ContentResources> content_resources;
+
+        // drawForm() isn't passed the state so the last one seen is
+        // kept. saveState() is given the state being saved, not its
+        // copy, so every callback for a field read by drawForm()
+        // updates it. Leading (TL) has no callback of its own
+        GfxState* cur_state;
+        int cur_page_num;
+
         // non-virtual methods; helpers
         bool process_image_blob(const std::ostringstream& blob, const PdfTM& ctm,
                                 const BoundingBox& bbox, const StreamProps& properties,
                                 int width, int height,
                                 intmax_t& ref_num);
+        bool skip_text(GfxState* state, bool& invisible) const;
+        void add_character(double x, double y, double w, double h,
+                           CharCode code, Unicode* u,
+                           const TextMetrics& metrics, bool invisible);
         void build_path_command(GfxState* state, PdfDocPath::Type type,
                                 PdfDocPath::EvenOddRule eo_rule = PdfDocPath::EVEN_ODD_RULE_DISABLED);
+        bool tiling_pattern_key(GfxState* state, Object* str, Dict* resDict, const double* bbox,
+                                int paint_type, double x_step, double y_step, std::string& key);
+        PdfForm* read_form(Ref id);
+        bool form_has_resources(Ref id);
+        uintmax_t register_shading_color(GfxColorSpace* color_space, GfxColor* color);
+        void sample_shading_stops(GfxUnivariateShading* shading, PdfShading& edsel_shading);
     };
 
 } // namespace
@@ -50,6 +50,9 @@ namespace pdftoedn
     static const pdftoedn::Symbol SYMBOL_FONT_ENG_FONT_WARN = "found_font_warnings";
 
     static const pdftoedn::Symbol SYMBOL_VERSIONS           = "versions";
+    static const pdftoedn::Symbol SYMBOL_X_DELTA_SCALE      = "x_delta_scale";
+    static const pdftoedn::Symbol SYMBOL_SHARED_CONTENT     = "shared_content";
+    static const pdftoedn::Symbol SYMBOL_SYMBOLS            = "symbols";
 
     const double PDFReader::DPI_72 = 72.0;
 
@@ -114,7 +117,7 @@ namespace pdftoedn
                 pre_process_fonts();
             }
 #endif
-            eng_odev = new pdftoedn::OutputDev(getCatalog(), font_engine);
+            eng_odev = new pdftoedn::OutputDev(this, font_engine);
 
             // use page crop box if requested (page media box is the default)
             if (pdftoedn::options.use_page_crop_box()) {
@@ -168,7 +171,7 @@ namespace pdftoedn
     //
     // document meta output in EDN format
     std::ostream& PDFReader::output_meta(std::ostream& o) {
-        util::edn::Hash meta_h(14);
+        util::edn::Hash meta_h(15);
 
         meta_h.push( util::version::SYMBOL_DATA_FORMAT_VERSION, util::version::data_format_version() );
         meta_h.push( SYMBOL_PDF_FILENAME                      , pdftoedn::options.pdf_filename() );
@@ -184,6 +187,21 @@ namespace pdftoedn
 
         meta_h.push( SYMBOL_PDF_NUM_PAGES                 , (uintmax_t) getNumPages() );
 
+        // units of the compact text x positions, if enabled
+        if (pdftoedn::options.x_delta_scale() > 0) {
+            meta_h.push( SYMBOL_X_DELTA_SCALE             , pdftoedn::options.x_delta_scale() );
+        }
+
+        // text repeated across pages, if requested
+        if (pdftoedn::options.dedupe_shared_content()) {
+            meta_h.push( SYMBOL_SHARED_CONTENT            , &shared_content );
+        }
+
+        // and repeated path geometry
+        if (pdftoedn::options.path_symbols()) {
+            meta_h.push( SYMBOL_SYMBOLS                   , &path_symbols );
+        }
+
         // outline - empty hash if none
         meta_h.push( SYMBOL_PDF_OUTLINE                   , &outline_output );
 
@@ -267,6 +285,41 @@ namespace pdftoedn
         return o;
     }
 
+    //
+    // pre-pass over the pages to fingerprint their text and / or
+    // paths. Pages are processed as usual but their data is discarded
+    void PDFReader::find_shared_content(uintmax_t start_page, uintmax_t end_page)
+    {
+        for (uintmax_t ii = start_page; ii < end_page; ++ii) {
+            process_page(eng_odev, ii + 1);
+
+            const PdfPage* page = eng_odev->page_data();
+            if (page) {
+                if (options.dedupe_shared_content()) {
+                    page->collect_shared_content(shared_content);
+                }
+                if (options.path_symbols()) {
+                    page->collect_path_symbols(path_symbols);
+                }
+            }
+        }
+
+        if (options.dedupe_shared_content()) {
+            shared_content.select(end_page - start_page);
+            eng_odev->set_shared_content(&shared_content);
+        }
+        if (options.path_symbols()) {
+            path_symbols.select();
+            eng_odev->set_path_symbols(&path_symbols);
+        }
+
+        // the output pass reports its own glyphs, patterns, forms and
+        // errors
+        font_engine.reset_glyph_output();
+        eng_odev->reset_resource_output();
+        et.flush_errors();
+    }
+
     std::ostream& PDFReader::process(std::ostream& o)
     {
         // return a hash with the data in the format
@@ -274,11 +327,6 @@ namespace pdftoedn
         static const pdftoedn::Symbol Meta("meta");
         static const pdftoedn::Symbol Pages("pages");
 
-        // but dont store it in a hash so we write a page at a time
-        o << "{" << Meta << " ";
-        output_meta(o);
-        o << ", " << Pages << " [";
-
         uintmax_t start_page, end_page;
 
         if (options.page_number() < 0) {
@@ -289,6 +337,18 @@ namespace pdftoedn
             end_page = start_page + 1;
         }
 
+        // shared content and symbols are output in the meta so they
+        // must be found before anything is written
+        if ((options.dedupe_shared_content() || options.path_symbols()) &&
+            !options.link_output_only()) {
+            find_shared_content(start_page, end_page);
+        }
+
+        // but dont store it in a hash so we write a page at a time
+        o << "{" << Meta << " ";
+        output_meta(o);
+        o << ", " << Pages << " [";
+
         for (uintmax_t ii = start_page; ii < end_page; ++ii) {
             output_page(ii, o);
         }
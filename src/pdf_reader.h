@@ -31,6 +31,8 @@
 #include "font_engine.h"
 #include "pdf_doc_outline.h"
 #include "pdf_output_dev.h"
+#include "shared_content.h"
+#include "path_symbols.h"
 
 class LinkGoTo;
 class LinkGoToR;
@@ -62,6 +64,8 @@ namespace pdftoedn
         pdftoedn::FontEngine font_engine;
         pdftoedn::EngOutputDev* eng_odev;
         pdftoedn::PdfOutline outline_output;
+        pdftoedn::SharedContent shared_content;
+        pdftoedn::PathSymbols path_symbols;
         bool use_page_media_box;
 
         bool init_font_engine();
@@ -74,6 +78,7 @@ namespace pdftoedn
         uintmax_t get_link_page_num(LinkDest* link);
 
         void process_page(::OutputDev* dev, uintmax_t page);
+        void find_shared_content(uintmax_t start_page, uintmax_t end_page);
 
         // returns document metadata
         std::ostream& output_meta(std::ostream& o);
@@ -0,0 +1,112 @@
+//
+// Copyright 2016-2017 Ed Porras
+//
+// This file is part of pdftoedn.
+//
+// pdftoedn is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// pdftoedn is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with pdftoedn.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <vector>
+#include <map>
+
+namespace pdftoedn
+{
+    // -------------------------------------------------------
+    // counts repeated content seen in a pre-pass over the document
+    // (shared text, path symbols) and indexes the entries that repeat
+    // enough. Each entry is built from its key's first occurrence;
+    // uses within the same group (e.g., page) are counted once
+    //
+    template <typename K, typename E>
+    class RepeatedEntries {
+    public:
+        RepeatedEntries() : num_adds(0) {}
+
+        // count a use of the key in the group. make_entry() is only
+        // called on its first use
+        template <typename F>
+        void add(const K& key, uintmax_t group, F make_entry) {
+            ++num_adds;
+            typename std::map<K, Slot>::iterator si = slots.find(key);
+            if (si == slots.end()) {
+                seen.push_back( slots.insert( std::make_pair(key, Slot(make_entry(), group)) ).first );
+                return;
+            }
+            if (si->second.last_group != group) {
+                si->second.last_group = group;
+                si->second.count++;
+            }
+        }
+
+        // count every use of the key
+        template <typename F>
+        void add(const K& key, F make_entry) { add(key, num_adds, make_entry); }
+
+        // index the entries used at least min_count times, in order
+        // of first appearance; the rest are dropped
+        void select(uintmax_t min_count) {
+            for (typename std::map<K, Slot>::iterator si : seen) {
+                if (si->second.count >= min_count) {
+                    si->second.idx = selected.size();
+                    selected.push_back(si);
+                }
+                else {
+                    slots.erase(si);
+                }
+            }
+            seen.clear();
+        }
+
+        // index of the selected entry matching the key or -1
+        intmax_t find(const K& key) const {
+            typename std::map<K, Slot>::const_iterator si = slots.find(key);
+            if (si == slots.end()) {
+                return -1;
+            }
+            return si->second.idx;
+        }
+
+        uintmax_t size() const { return selected.size(); }
+
+        // calls f(key, entry, count) for each selected entry, by
+        // index
+        template <typename F>
+        void for_each(F f) const {
+            for (SlotIter si : selected) {
+                f(si->first, si->second.entry, si->second.count);
+            }
+        }
+
+    private:
+        struct Slot {
+            Slot(const E& e, uintmax_t group) :
+                entry(e), count(1), last_group(group), idx(-1)
+            { }
+
+            E entry;
+            uintmax_t count;
+            uintmax_t last_group;
+            intmax_t idx;
+        };
+
+        typedef typename std::map<K, Slot>::const_iterator SlotIter;
+
+        std::map<K, Slot> slots;
+        std::vector<typename std::map<K, Slot>::iterator> seen; // in order of first appearance
+        std::vector<SlotIter> selected;
+        uintmax_t num_adds;
+    };
+
+} // namespace
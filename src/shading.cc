@@ -0,0 +1,121 @@
+//
+// Copyright 2016-2017 Ed Porras
+//
+// This file is part of pdftoedn.
+//
+// pdftoedn is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// pdftoedn is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with pdftoedn.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "shading.h"
+#include "util_edn.h"
+
+namespace pdftoedn
+{
+    const pdftoedn::Symbol PdfShading::SYMBOL_TYPE_SHADING     = "shading";
+    const pdftoedn::Symbol PdfShading::SYMBOL_SHADING_TYPE     = "shading_type";
+    const pdftoedn::Symbol PdfShading::SYMBOL_SHADING_TYPES[]  = { "function", "axial", "radial", "triangles" };
+    const pdftoedn::Symbol PdfShading::SYMBOL_COORDS           = "coords";
+    const pdftoedn::Symbol PdfShading::SYMBOL_EXTEND           = "extend";
+    const pdftoedn::Symbol PdfShading::SYMBOL_STOPS            = "stops";
+    const pdftoedn::Symbol PdfShading::SYMBOL_DOMAIN           = "domain";
+    const pdftoedn::Symbol PdfShading::SYMBOL_SAMPLES          = "samples";
+    const pdftoedn::Symbol PdfShading::SYMBOL_TRIANGLES        = "triangles";
+    const pdftoedn::Symbol PdfShading::SYMBOL_TRANSFORM        = "transform";
+
+    //
+    // {:type :shading, :shading_type :axial, :bbox [...], :transform
+    // [a b c d e f], :coords [...], :extend [..], :stops [[offset
+    // color_idx] ...]}
+    std::ostream& PdfShading::to_edn(std::ostream& o) const
+    {
+        util::edn::Hash shading_h(8);
+        shading_h.push( SYMBOL_TYPE,                 cmd );
+        shading_h.push( SYMBOL_SHADING_TYPE,         SYMBOL_SHADING_TYPES[type] );
+        shading_h.push( BoundingBox::SYMBOL,         bbox );
+
+        util::edn::Vector tm_a(6);
+        tm_a.push( tm.a() );
+        tm_a.push( tm.b() );
+        tm_a.push( tm.c() );
+        tm_a.push( tm.d() );
+        tm_a.push( tm.e() );
+        tm_a.push( tm.f() );
+        shading_h.push( SYMBOL_TRANSFORM,            tm_a );
+
+        if (type == AXIAL || type == RADIAL) {
+            util::edn::Vector coords_a(coords.size());
+            for (double v : coords) {
+                coords_a.push( v );
+            }
+            shading_h.push( SYMBOL_COORDS,           coords_a );
+
+            util::edn::Vector extend_a(2);
+            extend_a.push( extend[0] );
+            extend_a.push( extend[1] );
+            shading_h.push( SYMBOL_EXTEND,           extend_a );
+
+            util::edn::Vector stops_a(offsets.size());
+            for (uintmax_t i = 0; i < offsets.size(); ++i) {
+                util::edn::Vector stop_a(2);
+                stop_a.push( offsets[i] );
+                stop_a.push( colors[i] );
+                stops_a.push( stop_a );
+            }
+            shading_h.push( SYMBOL_STOPS,            stops_a );
+        }
+        else if (type == FUNCTION) {
+            util::edn::Vector domain_a(coords.size());
+            for (double v : coords) {
+                domain_a.push( v );
+            }
+            shading_h.push( SYMBOL_DOMAIN,           domain_a );
+
+            // one row per grid line, top to bottom of the domain
+            util::edn::Vector samples_a(FUNCTION_GRID_SIZE);
+            for (uintmax_t r = 0; r < colors.size(); r += FUNCTION_GRID_SIZE) {
+                util::edn::Vector row_a(FUNCTION_GRID_SIZE);
+                for (uintmax_t c = r; c < r + FUNCTION_GRID_SIZE && c < colors.size(); ++c) {
+                    row_a.push( colors[c] );
+                }
+                samples_a.push( row_a );
+            }
+            shading_h.push( SYMBOL_SAMPLES,          samples_a );
+        }
+        else {
+            // [x0 y0 color0 x1 y1 color1 x2 y2 color2] per triangle
+            util::edn::Vector triangles_a(colors.size() / 3);
+            for (uintmax_t t = 0; t + 2 < colors.size(); t += 3) {
+                util::edn::Vector tri_a(9);
+                for (uintmax_t v = t; v < t + 3; ++v) {
+                    tri_a.push( coords[v * 2] );
+                    tri_a.push( coords[v * 2 + 1] );
+                    tri_a.push( colors[v] );
+                }
+                triangles_a.push( tri_a );
+            }
+            shading_h.push( SYMBOL_TRIANGLES,        triangles_a );
+        }
+
+        if (clip_path_id != -1) {
+            shading_h.push( PdfDocPath::SYMBOL_CLIP_TO, clip_path_id );
+        }
+        if (opacity < 1.0) {
+            shading_h.push( GfxAttribs::SYMBOL_FILL_OPACITY, opacity );
+        }
+
+        o << shading_h;
+        return o;
+    }
+
+} // namespace
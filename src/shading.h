@@ -0,0 +1,97 @@
+//
+// Copyright 2016-2017 Ed Porras
+//
+// This file is part of pdftoedn.
+//
+// pdftoedn is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// pdftoedn is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with pdftoedn.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include <ostream>
+#include <vector>
+
+#include "base_types.h"
+#include "graphics.h"
+
+namespace pdftoedn
+{
+    // -------------------------------------------------------
+    // smooth shading (sh operator or shading pattern fill). Output
+    // as a descriptor instead of the many small fills poppler would
+    // otherwise subdivide it into. Coordinates are in shading space;
+    // the transform maps them to the page. Colors are indices in the
+    // page's color table
+    //
+    class PdfShading : public PdfGfxCmd {
+    public:
+        enum Type { FUNCTION, AXIAL, RADIAL, TRIANGLES };
+
+        static const pdftoedn::Symbol SYMBOL_TYPE_SHADING;
+        static const pdftoedn::Symbol SYMBOL_SHADING_TYPE;
+        static const pdftoedn::Symbol SYMBOL_SHADING_TYPES[];
+        static const pdftoedn::Symbol SYMBOL_COORDS;
+        static const pdftoedn::Symbol SYMBOL_EXTEND;
+        static const pdftoedn::Symbol SYMBOL_STOPS;
+        static const pdftoedn::Symbol SYMBOL_DOMAIN;
+        static const pdftoedn::Symbol SYMBOL_SAMPLES;
+        static const pdftoedn::Symbol SYMBOL_TRIANGLES;
+        static const pdftoedn::Symbol SYMBOL_TRANSFORM;
+
+        // constructor - coords are: [x0 y0 x1 y1] for axial, [x0 y0
+        // r0 x1 y1 r1] for radial, the [x0 y0 x1 y1] domain for
+        // function shadings and each triangle's vertices for the
+        // triangle meshes
+        PdfShading(Type shading_type, const PdfTM& shading_tm, const BoundingBox& b,
+                   double fill_opacity) :
+            PdfGfxCmd(SYMBOL_TYPE_SHADING),
+            type(shading_type), tm(shading_tm), bbox(b), opacity(fill_opacity),
+            clip_path_id(-1)
+        {
+            extend[0] = extend[1] = false;
+        }
+
+        void set_clip_id(intmax_t clip_id) { clip_path_id = clip_id; }
+        void clip_bounds(const BoundingBox& clip_bbox) { bbox = bbox.clip(clip_bbox); }
+        const BoundingBox& bounding_box() const { return bbox; }
+
+        void set_extend(bool e0, bool e1) { extend[0] = e0; extend[1] = e1; }
+        void add_coord(double v) { coords.push_back(v); }
+        // axial & radial: color at offset 0..1 along the shading
+        void add_stop(double offset, uintmax_t color_idx) {
+            offsets.push_back(offset);
+            colors.push_back(color_idx);
+        }
+        // function: grid samples, row by row; triangles: one per
+        // vertex
+        void add_color(uintmax_t color_idx) { colors.push_back(color_idx); }
+
+        virtual std::ostream& to_edn(std::ostream& o) const;
+
+        // grid size function shadings are sampled at
+        enum { FUNCTION_GRID_SIZE = 16 };
+
+    private:
+        Type type;
+        PdfTM tm;
+        BoundingBox bbox;
+        double opacity;
+        intmax_t clip_path_id;
+        bool extend[2];
+        std::vector<double> coords;
+        std::vector<double> offsets;
+        std::vector<uintmax_t> colors;
+    };
+
+} // namespace
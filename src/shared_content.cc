@@ -0,0 +1,122 @@
+//
+// Copyright 2016-2017 Ed Porras
+//
+// This file is part of pdftoedn.
+//
+// pdftoedn is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// pdftoedn is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with pdftoedn.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <algorithm>
+#include <sstream>
+#include <iomanip>
+
+#include "shared_content.h"
+#include "text.h"
+#include "font.h"
+#include "util.h"
+#include "util_edn.h"
+
+namespace pdftoedn
+{
+    static const pdftoedn::Symbol SYMBOL_TEXT                = "text";
+    static const pdftoedn::Symbol SYMBOL_FONT                = "font";
+    static const pdftoedn::Symbol SYMBOL_PT_SIZE             = "size";
+    static const pdftoedn::Symbol SYMBOL_COLOR               = "color";
+    static const pdftoedn::Symbol SYMBOL_X_POS_VECTOR        = "x_vector";
+    static const pdftoedn::Symbol SYMBOL_NUM_PAGES           = "num_pages";
+
+    const uintmax_t SharedContent::MIN_PAGES                 = 3;
+
+
+    // =============================================
+    // SharedContent
+    //
+    bool SharedContent::Key::operator<(const Key& k) const
+    {
+        if (text != k.text)               return (text < k.text);
+        if (font_family != k.font_family) return (font_family < k.font_family);
+        if (bold != k.bold)               return (bold < k.bold);
+        if (italic != k.italic)           return (italic < k.italic);
+        if (font_size != k.font_size)     return (font_size < k.font_size);
+        if (color != k.color)             return (color < k.color);
+        if (x1 != k.x1)                   return (x1 < k.x1);
+        if (y1 != k.y1)                   return (y1 < k.y1);
+        if (x2 != k.x2)                   return (x2 < k.x2);
+        return (y2 < k.y2);
+    }
+
+    //
+    // the first occurrence of a span is the one output
+    SharedContent::Entry::Entry(const PdfText& span) :
+        bbox(span.bounding_box()), x_pos(span.x_positions())
+    {
+        util::utf32_to_utfstring(span.text(), text);
+    }
+
+    //
+    // a span is counted once per page
+    void SharedContent::add(const Key& key, const PdfText& span, uintmax_t page_num)
+    {
+        entries.add(key, page_num, [&]() { return Entry(span); });
+    }
+
+    void SharedContent::select(uintmax_t num_pages)
+    {
+        entries.select(std::max<uintmax_t>(2, std::min(MIN_PAGES, num_pages)));
+    }
+
+    intmax_t SharedContent::find(const Key& key) const
+    {
+        return entries.find(key);
+    }
+
+    //
+    // [{:text "..." :bbox [...] :font {...} :size N :color "#rrggbb" :x_vector [...] :num_pages N} ...]
+    std::ostream& SharedContent::to_edn(std::ostream& o) const
+    {
+        util::edn::Vector shared_a(entries.size());
+
+        entries.for_each([&](const Key& k, const Entry& e, uintmax_t num_pages) {
+            util::edn::Hash font_h(3);
+            font_h.push( PdfFont::SYMBOL_FAMILY,                k.font_family );
+            if (k.bold) {
+                font_h.push( PdfFont::SYMBOL_STYLE_BOLD,        true );
+            }
+            if (k.italic) {
+                font_h.push( PdfFont::SYMBOL_STYLE_ITALIC,      true );
+            }
+
+            std::stringstream color;
+            color << "#" << std::setfill('0') << std::setw(6) << std::hex << k.color;
+
+            util::edn::Vector x_pos_a(e.x_pos.size());
+            for (double x : e.x_pos) {
+                x_pos_a.push( x );
+            }
+
+            util::edn::Hash entry_h(7);
+            entry_h.push( SYMBOL_TEXT,                          e.text );
+            entry_h.push( BoundingBox::SYMBOL,                  e.bbox );
+            entry_h.push( SYMBOL_FONT,                          font_h );
+            entry_h.push( SYMBOL_PT_SIZE,                       k.font_size / 100.0 );
+            entry_h.push( SYMBOL_COLOR,                         color.str() );
+            entry_h.push( SYMBOL_X_POS_VECTOR,                  x_pos_a );
+            entry_h.push( SYMBOL_NUM_PAGES,                     num_pages );
+            shared_a.push( entry_h );
+        });
+
+        o << shared_a;
+        return o;
+    }
+
+} // namespace
@@ -0,0 +1,82 @@
+//
+// Copyright 2016-2017 Ed Porras
+//
+// This file is part of pdftoedn.
+//
+// pdftoedn is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// pdftoedn is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with pdftoedn.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "base_types.h"
+#include "repeated_entries.h"
+
+namespace pdftoedn
+{
+    class PdfText;
+
+    // -------------------------------------------------------
+    // text repeated across pages (running headers, footers,
+    // watermarks). Spans are fingerprinted by their text, font and
+    // rounded bbox during a pre-pass over the document; the ones
+    // found on enough pages are output once in the document meta and
+    // pages refer to them by index instead of including the spans
+    //
+    class SharedContent : public gemable {
+    public:
+        // span fingerprint - independent of the page's resource
+        // tables so it can be compared across pages
+        struct Key {
+            std::u32string text;
+            std::string font_family;
+            bool bold, italic;
+            intmax_t font_size;       // 1/100 pt
+            uint32_t color;           // 0xrrggbb
+            intmax_t x1, y1, x2, y2;  // nearest pt
+
+            bool operator<(const Key& k) const;
+        };
+
+
+        // pre-pass: count the pages each span is seen on
+        void add(const Key& key, const PdfText& span, uintmax_t page_num);
+        // keep the entries seen on enough pages of the ones scanned
+        void select(uintmax_t num_pages);
+
+        // index of the shared entry matching the key or -1
+        intmax_t find(const Key& key) const;
+
+        std::ostream& to_edn(std::ostream& o) const;
+
+        // a span must be seen on at least this many pages (or all
+        // pages in shorter docs) to be shared
+        static const uintmax_t MIN_PAGES;
+
+    private:
+        struct Entry {
+            Entry(const PdfText& span);
+
+            std::string text;
+            BoundingBox bbox;
+            std::vector<double> x_pos;
+        };
+
+        // counted once per page
+        RepeatedEntries<Key, Entry> entries;
+    };
+
+} // namespace
@@ -0,0 +1,134 @@
+//
+// Copyright 2016-2017 Ed Porras
+//
+// This file is part of pdftoedn.
+//
+// pdftoedn is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// pdftoedn is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with pdftoedn.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+#include "base_types.h"
+
+namespace pdftoedn
+{
+    // -------------------------------------------------------
+    // uniform grid used to look up items by location on a page
+    // without scanning every item. Items are registered in every
+    // cell their bbox touches; anything outside the grid's area is
+    // clamped to the edge cells. Queries return candidates only - the
+    // caller must still test the actual geometry
+    //
+    template <typename T>
+    class SpatialGrid {
+    public:
+        SpatialGrid(const BoundingBox& area, double cell_size) :
+            origin(area.p1())
+        {
+            cols = num_cells(area.width(), cell_size);
+            rows = num_cells(area.height(), cell_size);
+            cell_w = (area.width() > 0) ? (area.width() / cols) : cell_size;
+            cell_h = (area.height() > 0) ? (area.height() / rows) : cell_size;
+            cells.resize(cols * rows);
+        }
+
+        // register an item in the cells covered by the bbox. Cells
+        // keep items in insertion order
+        void insert(const T& item, const BoundingBox& bbox) {
+            uintmax_t c1 = col(bbox.x_min()), c2 = col(bbox.x_max());
+            uintmax_t r1 = row(bbox.y_min()), r2 = row(bbox.y_max());
+
+            for (uintmax_t r = r1; r <= r2; ++r) {
+                for (uintmax_t c = c1; c <= c2; ++c) {
+                    cells[r * cols + c].push_back(item);
+                }
+            }
+        }
+
+        // unregister an item - bbox must be the one it was inserted
+        // with
+        void remove(const T& item, const BoundingBox& bbox) {
+            uintmax_t c1 = col(bbox.x_min()), c2 = col(bbox.x_max());
+            uintmax_t r1 = row(bbox.y_min()), r2 = row(bbox.y_max());
+
+            for (uintmax_t r = r1; r <= r2; ++r) {
+                for (uintmax_t c = c1; c <= c2; ++c) {
+                    std::vector<T>& cell = cells[r * cols + c];
+                    auto ii = std::find(cell.begin(), cell.end(), item);
+                    if (ii != cell.end()) {
+                        cell.erase(ii);
+                    }
+                }
+            }
+        }
+
+        // items registered in the cell containing the point
+        const std::vector<T>& query(const Coord& c) const {
+            return cells[row(c.y) * cols + col(c.x)];
+        }
+
+        // items registered in the cells covered by the bbox. An item
+        // spanning multiple cells is returned once per cell
+        void query(const BoundingBox& bbox, std::vector<T>& items) const {
+            uintmax_t c1 = col(bbox.x_min()), c2 = col(bbox.x_max());
+            uintmax_t r1 = row(bbox.y_min()), r2 = row(bbox.y_max());
+
+            for (uintmax_t r = r1; r <= r2; ++r) {
+                for (uintmax_t c = c1; c <= c2; ++c) {
+                    const std::vector<T>& cell = cells[r * cols + c];
+                    items.insert(items.end(), cell.begin(), cell.end());
+                }
+            }
+        }
+
+        void clear() {
+            for (std::vector<T>& cell : cells) { cell.clear(); }
+        }
+
+    private:
+        // keep the number of cells sane for very large pages
+        enum { MAX_CELLS_PER_AXIS = 128 };
+
+        Coord origin;
+        double cell_w, cell_h;
+        uintmax_t cols, rows;
+        std::vector< std::vector<T> > cells;
+
+        static uintmax_t num_cells(double length, double cell_size) {
+            if (!(length > cell_size)) {
+                return 1;
+            }
+            return std::min<uintmax_t>(std::ceil(length / cell_size), MAX_CELLS_PER_AXIS);
+        }
+
+        // map a coordinate to a cell index, clamping anything outside
+        // the area (or non-finite) to the edges
+        static uintmax_t cell_index(double v, double o, double size, uintmax_t count) {
+            double i = (v - o) / size;
+            if (!(i > 0)) {
+                return 0;
+            }
+            if (i >= count) {
+                return count - 1;
+            }
+            return static_cast<uintmax_t>(i);
+        }
+        uintmax_t col(double x) const { return cell_index(x, origin.x, cell_w, cols); }
+        uintmax_t row(double y) const { return cell_index(y, origin.y, cell_h, rows); }
+    };
+
+} // namespace
@@ -22,11 +22,14 @@
 #include <ostream>
 #include <complex>
 
+#include <boost/functional/hash.hpp>
+
 #include "doc_page.h"
 #include "text.h"
 #include "transforms.h"
 #include "util.h"
 #include "util_edn.h"
+#include "edsel_options.h"
 
 namespace pdftoedn
 {
@@ -39,15 +42,21 @@ namespace pdftoedn
 
     static const pdftoedn::Symbol SYMBOL_X_POS_VECTOR   = "x_vector";
     static const pdftoedn::Symbol SYMBOL_Y_POS_VECTOR   = "y_vector";
+    static const pdftoedn::Symbol SYMBOL_X_DELTAS       = "x_deltas";
     static const pdftoedn::Symbol SYMBOL_TEXT           = "text";
     static const pdftoedn::Symbol SYMBOL_PT_SIZE        = "size";
     static const pdftoedn::Symbol SYMBOL_INVISIBLE      = "invisible";
     static const pdftoedn::Symbol SYMBOL_LINK_IDX       = "link_idx";
+    static const pdftoedn::Symbol SYMBOL_SPANS          = "spans";
+    static const pdftoedn::Symbol SYMBOL_WORDS          = "words";
 
     // when two spans overlap, this is the minimum ratio between their
     // intersection and union to call it a full overlap
     const double PdfText::SPAN_OVERLAP_THRESHOLD = 0.75;
 
+    // same as the minimum whitespace gap used when joining characters
+    const double PdfTextLine::WORD_GAP_RATIO = 0.2;
+
     // =============================================
     // TextAttribs
     //
@@ -59,6 +68,16 @@ namespace pdftoedn
         baseline_threshold = font_size * YPOS_THRESHOLD / 100;
     }
 
+    size_t TextAttribs::hash::operator()(const TextAttribs& a) const
+    {
+        size_t seed = 0;
+        boost::hash_combine(seed, a.font_idx);
+        boost::hash_combine(seed, a.font_size);
+        boost::hash_combine(seed, a.invisible);
+        boost::hash_combine(seed, a.link_idx);
+        return seed;
+    }
+
     // =============================================
     // PdfChar - a unicode character
     //
@@ -79,7 +98,7 @@ namespace pdftoedn
             return false;
         }
 
-        double scaling = attribs.txt.font_size * metrics.horiz_scaling;
+        double scaling = attribs.txt->font_size * metrics.horiz_scaling;
         double max_space = 2 * scaling;
 
         // found cases where a very large whitespace is used to
@@ -99,7 +118,7 @@ namespace pdftoedn
         // if we're dealing with a glyph, or text attributes are not
         // equal or the position delta is not within some magic
         // numbers, it is not spannable
-        if (glyph_idx != -1) {
+        if (glyph_idx != -1 || prev.glyph_idx != -1) {
             return false;
         }
 
@@ -123,7 +142,7 @@ namespace pdftoedn
         // attribs comparison included link index but, if it's
         // set (!= -1), then don't break up the span since it's
         // on the same line
-        if ((attribs.txt.link_idx == -1) &&
+        if ((attribs.txt->link_idx == -1) &&
             // if there's a gap, only break it up if they're both not whitespace
             (((bbox_delta > min_ws_space) && (!prev.is_space() && !is_space())) ||
              // or if it's a large gap, split it
@@ -231,15 +250,37 @@ namespace pdftoedn
     }
 
     //
-    // TESLA-7177: give a small amount of play when comparing vertical
-    // position of text spans
-    bool PdfText::is_positioned_before(const PdfBoxedItem* bi) const
+    // rebuild a character from the span's arrays - used to compare
+    // against incoming characters and to locate them for whiteout
+    PdfChar PdfText::char_at(uintmax_t i) const
     {
-        if (std::abs(y_max() - bi->y_max()) < attribs.txt.baseline_threshold) {
-            return (x_min() < bi->x_min());
-        }
+        return PdfChar(BoundingBox(Coord(char_x1[i], char_y1[i]), Coord(char_x2[i], char_y2[i])),
+                       ctm, unicode[i], attribs.txt, attribs.gfx,
+                       TextMetrics(0, 0, 0, 1), glyph_idx[i], attribs.clip_path_id);
+    }
 
-        return (y_max() < bi->y_max());
+    //
+    // remove a range of characters
+    void PdfText::erase(uintmax_t i, uintmax_t count)
+    {
+        char_x1.erase(char_x1.begin() + i, char_x1.begin() + i + count);
+        char_y1.erase(char_y1.begin() + i, char_y1.begin() + i + count);
+        char_x2.erase(char_x2.begin() + i, char_x2.begin() + i + count);
+        char_y2.erase(char_y2.begin() + i, char_y2.begin() + i + count);
+        unicode.erase(i, count);
+        glyph_idx.erase(glyph_idx.begin() + i, glyph_idx.begin() + i + count);
+    }
+
+    //
+    // move character i to position j (j <= i)
+    void PdfText::move(uintmax_t i, uintmax_t j)
+    {
+        char_x1[j] = char_x1[i];
+        char_y1[j] = char_y1[i];
+        char_x2[j] = char_x2[i];
+        char_y2[j] = char_y2[i];
+        unicode[j] = unicode[i];
+        glyph_idx[j] = glyph_idx[i];
     }
 
     //
@@ -247,37 +288,40 @@ namespace pdftoedn
     // with leading ws already)
     void PdfText::trim()
     {
-        while (!chars.empty())
-        {
-            if (!chars.back()->is_space()) {
-                break;
-            }
-            delete chars.back();
-            chars.pop_back();
+        uintmax_t len = length();
+        while (len > 0 && is_space(len - 1)) {
+            --len;
         }
+        erase(len, length() - len);
     }
 
     //
     // store / append a new character
-    bool PdfText::push_back(PdfChar* c)
+    bool PdfText::push_back(const PdfChar& c)
     {
         // is there a span created?
-        if (chars.empty())
+        if (unicode.empty())
         {
             // no. get the char data and set it for the span
-            ctm = c->ctm;
-            attribs = c->attribs; // all other common attributes
+            ctm = c.ctm;
+            attribs = c.attribs; // all other common attributes
         }
         else
         {
             // don't append back to back white-space
-            if (chars.back()->is_space() && c->is_space()) {
+            if (is_space(length() - 1) && c.is_space()) {
                 return false;
             }
         }
 
         // add the character now
-        chars.push_back(c);
+        const BoundingBox& b = c.bounding_box();
+        char_x1.push_back(b.x1());
+        char_y1.push_back(b.y1());
+        char_x2.push_back(b.x2());
+        char_y2.push_back(b.y2());
+        unicode += c.unicode;
+        glyph_idx.push_back(c.glyph_idx);
         return true;
     }
 
@@ -295,11 +339,12 @@ namespace pdftoedn
     void PdfText::finalize()
     {
         trim();
-        if (!chars.empty()) {
+        if (!unicode.empty()) {
+            uintmax_t last = length() - 1;
             Bounds b;
-            b = chars.front()->bounding_box();
-            if (chars.size() > 1) {
-                b.expand(chars.back()->bounding_box());
+            b = BoundingBox(Coord(char_x1[0], char_y1[0]), Coord(char_x2[0], char_y2[0]));
+            if (last > 0) {
+                b.expand(BoundingBox(Coord(char_x1[last], char_y1[last]), Coord(char_x2[last], char_y2[last])));
             }
             bbox = b.bounding_box();
         }
@@ -310,25 +355,29 @@ namespace pdftoedn
     // remove characters from the span covered by the region
     void PdfText::whiteout(const BoundingBox& wo_region)
     {
-        std::list<PdfChar *>::iterator ci = chars.begin();
+        uintmax_t len = length(), kept = 0, i = 0;
 
-        while (ci != chars.end())
+        for (; i < len; ++i)
         {
-            std::list<PdfChar *>::iterator cur = ci++;
-            PdfChar* c = *cur;
+            PdfChar c = char_at(i);
 
-            if (c->right() < wo_region.x_min()) {
+            if (c.right() < wo_region.x_min()) {
+                // keep it
+                move(i, kept++);
                 continue;
             }
 
-            if (c->left() > wo_region.x_max()) {
+            if (c.left() > wo_region.x_max()) {
                 break;
             }
+        }
 
-            delete c;
-            chars.erase(cur);
+        // keep the remaining characters
+        for (; i < len; ++i) {
+            move(i, kept++);
         }
 
+        erase(kept, len - kept);
         finalize();
     }
 
@@ -342,7 +391,7 @@ namespace pdftoedn
         // add a type identifier. TODO: This needs some cleaning up
         text_h.push( PdfGfxCmd::SYMBOL_TYPE, PdfText::SYMBOL_TYPE_SPAN );
 
-        double font_size = attribs.txt.font_size;
+        double font_size = attribs.txt->font_size;
         std::list<Transform *> transforms;
 
         // poppler doesn't produce proper bounding boxes; compensate here
@@ -435,52 +484,55 @@ namespace pdftoedn
 
         // run through the list of characters to build the string and
         // the x-position vector..
-        util::edn::Vector x_vector_a(chars.size());
+        util::edn::Vector x_vector_a(length());
         std::string str;
-        intmax_t glyph_idx = -1;
+        util::utf32_to_utfstring(unicode, str);
 
-        for (const PdfChar* c : chars) {
-            str += util::wstring_to_utfstring(c->wstr());
-
-            if (!ctm.is_rotated()) {
-                x_vector_a.push( c->bounding_box().x1() );
+        uintmax_t x_delta_scale = pdftoedn::options.x_delta_scale();
+        if (!ctm.is_rotated()) {
+            if (x_delta_scale > 0) {
+                x_deltas_to_edn(x_vector_a, x_delta_scale);
+            } else {
+                for (double x : char_x1) {
+                    x_vector_a.push( x );
+                }
             }
-
-            // if a glyph was encountered in the stream, length will
-            // be 1 always since they're not spannable
-            glyph_idx = c->get_glyph_index();
         }
 
+        // if a glyph was encountered in the stream, length will be 1
+        // always since they're not spannable
+        intmax_t span_glyph_idx = glyph_idx.back();
+
         text_h.push( SYMBOL_TEXT,                    str );
 
         // font and color data
-        text_h.push( PdfPage::SYMBOL_FONT_IDX,       attribs.txt.font_idx );
+        text_h.push( PdfPage::SYMBOL_FONT_IDX,       attribs.txt->font_idx );
         text_h.push( SYMBOL_PT_SIZE,                 font_size );
 
-        text_h.push( PdfPage::SYMBOL_COLOR_IDX,      attribs.gfx.fill.color_idx );
-        if (attribs.gfx.fill.opacity != 1.0) {
-            text_h.push( PdfPage::SYMBOL_OPACITY,    attribs.gfx.fill.opacity );
+        text_h.push( PdfPage::SYMBOL_COLOR_IDX,      attribs.gfx->fill.color_idx );
+        if (attribs.gfx->fill.opacity != 1.0) {
+            text_h.push( PdfPage::SYMBOL_OPACITY,    attribs.gfx->fill.opacity );
         }
 
-        text_h.push( SYMBOL_X_POS_VECTOR,            x_vector_a );
+        text_h.push( (x_delta_scale > 0 ? SYMBOL_X_DELTAS : SYMBOL_X_POS_VECTOR), x_vector_a );
 
-        if (glyph_idx != -1) {
-            text_h.push( PdfText::SYMBOL_GLYPH_IDX,  glyph_idx );
+        if (span_glyph_idx != -1) {
+            text_h.push( PdfText::SYMBOL_GLYPH_IDX,  span_glyph_idx );
         }
 
         if (attribs.clip_path_id != -1) {
             text_h.push( PdfDocPath::SYMBOL_CLIP_TO, attribs.clip_path_id );
         }
 
-        if (attribs.txt.link_idx != -1) {
-            text_h.push( SYMBOL_LINK_IDX,            attribs.txt.link_idx );
+        if (attribs.txt->link_idx != -1) {
+            text_h.push( SYMBOL_LINK_IDX,            attribs.txt->link_idx );
         }
 
         if (ctm.is_sheared()) {
             text_h.push( SYMBOL_SHEARED,             true );
         }
 
-        if (attribs.txt.invisible) {
+        if (attribs.txt->invisible) {
             text_h.push( SYMBOL_INVISIBLE,           true );
         }
 
@@ -492,16 +544,141 @@ namespace pdftoedn
     }
 
 
+    //
+    // compact form of the x-position vector: the first position
+    // followed by the distance to each next one as an integer number
+    // of 1/scale pt units. Runs of 3 or more equal deltas (e.g.,
+    // monospaced text) are written as [count delta]. Positions are
+    // quantized relative to the first so rounding doesn't accumulate
+    void PdfText::x_deltas_to_edn(util::edn::Vector& x_deltas_a, uintmax_t scale) const
+    {
+        x_deltas_a.push( char_x1.front() );
+
+        intmax_t prev_q = 0;
+        intmax_t run_delta = 0;
+        uintmax_t run_len = 0;
+
+        for (uintmax_t i = 1; i <= char_x1.size(); ++i) {
+            intmax_t delta = 0;
+            if (i < char_x1.size()) {
+                intmax_t q = std::llround((char_x1[i] - char_x1.front()) * scale);
+                delta = q - prev_q;
+                prev_q = q;
+
+                if (run_len > 0 && delta == run_delta) {
+                    ++run_len;
+                    continue;
+                }
+            }
+
+            // flush the pending run
+            if (run_len >= 3) {
+                util::edn::Vector run_a(2);
+                run_a.push( run_len );
+                run_a.push( run_delta );
+                x_deltas_a.push( run_a );
+            } else {
+                for (uintmax_t j = 0; j < run_len; ++j) {
+                    x_deltas_a.push( run_delta );
+                }
+            }
+
+            run_delta = delta;
+            run_len = 1;
+        }
+    }
+
+
     // =============================================
-    // PdfGlyph - unmapped character to be represented via a path
+    // PdfTextLine - spans sharing a baseline
+    //
+
+    //
+    // single pass over the line's spans (already sorted left to
+    // right) to compute its bounds and split it into words
+    void PdfTextLine::assemble(const std::vector<PdfText *>& spans, uintmax_t last_span_idx)
+    {
+        last_span = last_span_idx;
+
+        bool in_word = false;
+        CharPos word_start(first_span, 0), word_end(first_span, 0);
+        const PdfText* prev = NULL;
+
+        for (uintmax_t s = first_span; s <= last_span; ++s) {
+            const PdfText* t = spans[s];
+            bounds.expand(t->bounding_box());
+
+            // a word doesn't continue across rotated text or a gap
+            // between spans
+            if (in_word && prev &&
+                (t->CTM().is_rotated() || prev->CTM().is_rotated() ||
+                 (t->x_min() - prev->x_max() > WORD_GAP_RATIO * std::max(t->font_size(), prev->font_size())))) {
+                words.push_back( std::make_pair(word_start, word_end) );
+                in_word = false;
+            }
+
+            for (uintmax_t c = 0; c < t->length(); ++c) {
+                if (t->is_space(c)) {
+                    if (in_word) {
+                        words.push_back( std::make_pair(word_start, word_end) );
+                        in_word = false;
+                    }
+                    continue;
+                }
+
+                if (!in_word) {
+                    word_start = CharPos(s, c);
+                    in_word = true;
+                }
+                word_end = CharPos(s, c);
+            }
+            prev = t;
+        }
+
+        if (in_word) {
+            words.push_back( std::make_pair(word_start, word_end) );
+        }
+    }
+
     //
-#if 0
-    Rice::Object PdfGlyph::to_ruby() const
+    // {:spans [first last], :bbox [...], :words [[span chr span chr] ...]}
+    std::ostream& PdfTextLine::to_edn(std::ostream& o) const
     {
-        Rice::Hash path_h = PdfPath::to_ruby();
+        util::edn::Hash line_h(3);
+
+        util::edn::Vector spans_a(2);
+        spans_a.push( first_span );
+        spans_a.push( last_span );
+
+        util::edn::Vector words_a(words.size());
+        for (const std::pair<CharPos, CharPos>& w : words) {
+            util::edn::Vector word_a(4);
+            word_a.push( w.first.span );
+            word_a.push( w.first.chr );
+            word_a.push( w.second.span );
+            word_a.push( w.second.chr );
+            words_a.push( word_a );
+        }
+
+        line_h.push( SYMBOL_SPANS,                   spans_a );
+        line_h.push( BoundingBox::SYMBOL,            bounds.bounding_box() );
+        line_h.push( SYMBOL_WORDS,                   words_a );
+
+        o << line_h;
+        return o;
+    }
+
 
-        return path_h;
+    // =============================================
+    // PdfGlyph - unmapped character to be represented via a path
+    //
+    std::ostream& PdfGlyph::to_edn(std::ostream& o) const
+    {
+        util::edn::Hash glyph_h(6);
+        PdfPath::to_edn_hash(glyph_h);
+        glyph_h.push( PdfText::SYMBOL_GLYPH_IDX,        idx );
+        o << glyph_h;
+        return o;
     }
-#endif
 
 } // namespace
@@ -19,7 +19,9 @@
 #pragma once
 
 #include <ostream>
-#include <list>
+#include <string>
+#include <vector>
+#include <cwctype>
 #include "util.h"
 #include "base_types.h"
 #include "graphics.h"
@@ -50,6 +52,11 @@ namespace pdftoedn
         bool are_valid() const { return ((font_idx != -1) && (font_size != 0)); }
         void update_font(intmax_t font_index, double font_size);
 
+        // for interning attribs in a page table
+        struct hash {
+            size_t operator()(const TextAttribs& a) const;
+        };
+
         intmax_t font_idx;
         double font_size;
         double baseline_threshold;
@@ -78,18 +85,20 @@ namespace pdftoedn
     //
     class PdfChar : public PdfBoxedItem {
     public:
+        // attribs are interned by the page so only pointers to them
+        // are kept
         PdfChar(const BoundingBox& bbox,
                 const PdfTM& text_ctm, uintmax_t unicode_c,
-                const TextAttribs& txt_attribs, const GfxAttribs& g_attribs,
+                const TextAttribs* txt_attribs, const GfxAttribs* g_attribs,
                 const TextMetrics& txt_metrics,
                 intmax_t char_glyph_idx, intmax_t clip_id) :
             PdfBoxedItem(bbox, text_ctm),
             attribs(txt_attribs, g_attribs, clip_id), metrics(txt_metrics),
-            glyph_idx(char_glyph_idx)
-        { unicode = unicode_c; }
+            unicode(unicode_c), glyph_idx(char_glyph_idx)
+        { }
 
-        const std::wstring& wstr() const { return unicode; }
-        bool is_space() const { return std::iswspace(unicode[0]); }
+        char32_t code_point() const { return unicode; }
+        bool is_space() const { return std::iswspace(unicode); }
 
         // checks if this character is "adjacent" to another. That is,
         // this->spans(previous_char)?
@@ -108,18 +117,20 @@ namespace pdftoedn
         // attributes common to both PdfChar and PdfText
         struct Attribs
         {
-            TextAttribs txt;
-            GfxAttribs gfx;
+            const TextAttribs* txt;
+            const GfxAttribs* gfx;
             intmax_t clip_path_id;
 
-            Attribs() : clip_path_id(-1) {}
-            Attribs(const TextAttribs& ta, const GfxAttribs& ga, intmax_t cp_id) :
+            Attribs() : txt(NULL), gfx(NULL), clip_path_id(-1) {}
+            Attribs(const TextAttribs* ta, const GfxAttribs* ga, intmax_t cp_id) :
                 txt(ta), gfx(ga), clip_path_id(cp_id)
             {}
 
+            // interned text attribs are equal only if they're the same
+            // entry
             bool operator!=(const Attribs& a2) const {
                 return ( (txt != a2.txt) ||
-                         (gfx.fill != a2.gfx.fill) ||
+                         (gfx->fill != a2.gfx->fill) ||
                          (clip_path_id != a2.clip_path_id) );
             }
         };
@@ -127,7 +138,7 @@ namespace pdftoedn
     private:
         Attribs attribs;
         TextMetrics metrics;
-        std::wstring unicode;
+        char32_t unicode;
         intmax_t glyph_idx;
 
         friend class PdfText;
@@ -137,27 +148,37 @@ namespace pdftoedn
 
 
     // -------------------------------------------------------
-    // pdf text sequence. Collects characters in a list and computes
-    // bounding box with call to finalize() (done when the span is
-    // ready to be inserted)
+    // pdf text sequence. Collects character data in parallel arrays
+    // (all characters in a span share the same attribs and CTM) and
+    // computes bounding box with call to finalize() (done when the
+    // span is ready to be inserted)
     //
     class PdfText : public PdfBoxedItem {
     public:
 
-        PdfText() : overlap_pred(NULL) { }
-        PdfText(const PdfTM& ctm) : PdfBoxedItem(ctm), overlap_pred(NULL) { }
-        virtual ~PdfText() { util::delete_ptr_container_elems(chars); delete overlap_pred; }
+        PdfText() : seq(0), overlap_pred(NULL) { }
+        PdfText(const PdfTM& ctm) : PdfBoxedItem(ctm), seq(0), overlap_pred(NULL) { }
+        virtual ~PdfText() { delete overlap_pred; }
 
         // accessors, setters
-        uintmax_t length() const { return chars.size(); }
-        double font_size() const { return attribs.txt.font_size; }
-        bool spans(const PdfChar& c) const { return c.spans( *(chars.back()) ); }
-        bool push_back(PdfChar* c);
+        uintmax_t length() const { return unicode.size(); }
+        double font_size() const { return attribs.txt->font_size; }
+        bool spans(const PdfChar& c) const { return c.spans( char_at(length() - 1) ); }
+        bool push_back(const PdfChar& c);
         void whiteout(const BoundingBox& wo_region); // remove characters from the span covered by the region
         void finalize();
         intmax_t clip_id() const { return attribs.clip_path_id; }
-
-        virtual bool is_positioned_before(const PdfBoxedItem* i) const;
+        double baseline_threshold() const { return attribs.txt->baseline_threshold; }
+        bool is_space(uintmax_t i) const { return std::iswspace(unicode[i]); }
+        bool has_same_text(const PdfText& t) const { return (unicode == t.unicode); }
+        const std::u32string& text() const { return unicode; }
+        const std::vector<double>& x_positions() const { return char_x1; }
+        const PdfChar::Attribs& char_attribs() const { return attribs; }
+        bool has_glyphs() const { return (glyph_idx.back() != -1); }
+
+        // position in the page's paint order (shared w/ graphics)
+        void set_paint_seq(uintmax_t paint_seq) { seq = paint_seq; }
+        uintmax_t paint_seq() const { return seq; }
 
         // OverlapPred to check if a text span "overwrites" an existing one
         static const double SPAN_OVERLAP_THRESHOLD;
@@ -183,35 +204,78 @@ namespace pdftoedn
 
     private:
         PdfChar::Attribs attribs;
-        mutable std::list<PdfChar *> chars;
+
+        // per-character data
+        std::vector<double> char_x1, char_y1, char_x2, char_y2;
+        std::u32string unicode;
+        std::vector<intmax_t> glyph_idx;
+
+        uintmax_t seq;
+
         // used for checking text overlaps
         mutable OverlapPred *overlap_pred;
 
+        PdfChar char_at(uintmax_t i) const;
+        void x_deltas_to_edn(util::edn::Vector& x_deltas_a, uintmax_t scale) const;
+        void erase(uintmax_t i, uintmax_t count);
+        void move(uintmax_t i, uintmax_t j);
         void trim();
     };
 
 
     // -------------------------------------------------------
-    // pdf characters without mappings - must be drawn using paths
-    // TODO: FIX
+    // a line of text assembled from the page's sorted spans. Refers
+    // to the spans by index (first to last, inclusive) and splits
+    // them into words. A word is a range of characters that may
+    // cross into following spans if no whitespace or gap separates
+    // them
+    //
+    class PdfTextLine : public gemable {
+    public:
+        PdfTextLine(uintmax_t first_span_idx) :
+            first_span(first_span_idx), last_span(first_span_idx)
+        { }
+
+        // position of a character in the page's span list
+        struct CharPos {
+            CharPos(uintmax_t s, uintmax_t c) : span(s), chr(c) { }
+            uintmax_t span, chr;
+        };
+
+        void assemble(const std::vector<PdfText *>& spans, uintmax_t last_span_idx);
+
+        std::ostream& to_edn(std::ostream& o) const;
+
+        // words are split between spans if the gap is larger than
+        // this factor of the font size
+        static const double WORD_GAP_RATIO;
+
+    private:
+        uintmax_t first_span, last_span;
+        pdftoedn::Bounds bounds;
+        std::vector< std::pair<CharPos, CharPos> > words;
+    };
+
+
+    // -------------------------------------------------------
+    // pdf characters without mappings - output as their outline in
+    // em units (y up). Glyphs are shared across pages and referenced
+    // by spans via their document-wide index
+    //
     class PdfGlyph : public PdfPath {
     public:
-        PdfGlyph(uintmax_t glyph_font_idx, uintmax_t glyph_unicode) :
-            //            PdfPath(PdfGlyph::SYMBOL),
-            font_idx(glyph_font_idx), unicode(glyph_unicode)
+        PdfGlyph(uintmax_t doc_glyph_idx) :
+            idx(doc_glyph_idx)
         { }
 
-        bool equals(uintmax_t glyph_font_idx, uintmax_t glyph_unicode) const {
-            return ((glyph_font_idx == font_idx) && (glyph_unicode == unicode));
-        }
+        uintmax_t index() const { return idx; }
 
         static const pdftoedn::Symbol SYMBOL;
 
-        //        virtual Rice::Object to_ruby() const;
+        virtual std::ostream& to_edn(std::ostream& o) const;
 
     private:
-        uintmax_t font_idx;
-        uintmax_t unicode;
+        uintmax_t idx;
     };
 
 } // namespace
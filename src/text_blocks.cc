@@ -0,0 +1,265 @@
+//
+// Copyright 2016-2017 Ed Porras
+//
+// This file is part of pdftoedn.
+//
+// pdftoedn is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// pdftoedn is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with pdftoedn.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <algorithm>
+
+#include "text_blocks.h"
+#include "text.h"
+#include "util_edn.h"
+
+namespace pdftoedn
+{
+    static const pdftoedn::Symbol SYMBOL_SPANS               = "spans";
+
+    // columns are usually separated by at least an em; paragraphs by
+    // more than the usual line spacing
+    const double BlockSegmenter::X_GAP_RATIO                 = 1.0;
+    const double BlockSegmenter::Y_GAP_RATIO                 = 0.6;
+    const double BlockSegmenter::RULING_MAX_THICKNESS        = 3.0;
+    const double BlockSegmenter::WIDEST_GAP_TOLERANCE        = 0.9;
+
+
+    // =============================================
+    // PdfTextBlock
+    //
+
+    //
+    // keep the spans in page order within the block
+    void PdfTextBlock::sort_spans()
+    {
+        std::sort(spans.begin(), spans.end());
+    }
+
+    //
+    // {:bbox [...], :spans [idx ...]}
+    std::ostream& PdfTextBlock::to_edn(std::ostream& o) const
+    {
+        util::edn::Hash block_h(2);
+
+        util::edn::Vector spans_a(spans.size());
+        for (uintmax_t idx : spans) {
+            spans_a.push( idx );
+        }
+
+        block_h.push( BoundingBox::SYMBOL,           bounds.bounding_box() );
+        block_h.push( SYMBOL_SPANS,                  spans_a );
+
+        o << block_h;
+        return o;
+    }
+
+
+    // =============================================
+    // BlockSegmenter
+    //
+    BlockSegmenter::BlockSegmenter(const std::vector<PdfText *>& text_spans,
+                                   const std::vector<BoundingBox>& rulings)
+    {
+        items.reserve(text_spans.size());
+        for (uintmax_t i = 0; i < text_spans.size(); ++i) {
+            items.push_back( Item(text_spans[i]->bounding_box(), text_spans[i]->font_size(), i) );
+        }
+
+        // split the rulings by orientation
+        for (const BoundingBox& r : rulings) {
+            if (r.height() <= RULING_MAX_THICKNESS && r.width() > r.height()) {
+                Ruling h = { (r.y_min() + r.y_max()) / 2, r.x_min(), r.x_max() };
+                h_rulings.push_back(h);
+            }
+            else if (r.width() <= RULING_MAX_THICKNESS && r.height() > r.width()) {
+                Ruling v = { (r.x_min() + r.x_max()) / 2, r.y_min(), r.y_max() };
+                v_rulings.push_back(v);
+            }
+        }
+        std::sort(h_rulings.begin(), h_rulings.end());
+        std::sort(v_rulings.begin(), v_rulings.end());
+    }
+
+    //
+    // run the segmentation and return the blocks in reading order
+    void BlockSegmenter::segment(std::vector<PdfTextBlock>& blocks)
+    {
+        if (items.empty()) {
+            return;
+        }
+
+        // sort once per axis - by start, then page order
+        double font_size_sum = 0;
+        by_x.resize(items.size());
+        for (uintmax_t i = 0; i < items.size(); ++i) {
+            by_x[i] = i;
+            font_size_sum += items[i].font_size;
+        }
+        by_y = by_x;
+        for (Axis axis : { X_AXIS, Y_AXIS }) {
+            std::vector<uintmax_t>& sorted = (axis == X_AXIS ? by_x : by_y);
+            std::sort(sorted.begin(), sorted.end(), [=](uintmax_t a, uintmax_t b) {
+                    if (items[a].lo(axis) != items[b].lo(axis)) {
+                        return (items[a].lo(axis) < items[b].lo(axis));
+                    }
+                    return (a < b);
+                });
+        }
+        piece_of.resize(items.size());
+
+        cut(0, items.size(), font_size_sum, 0, blocks);
+    }
+
+    //
+    // recursively split the region covered by the items; if it can't
+    // be split, it is a block
+    void BlockSegmenter::cut(uintmax_t begin, uintmax_t end, double font_size_sum, uintmax_t depth,
+                             std::vector<PdfTextBlock>& blocks)
+    {
+        if (depth < MAX_DEPTH && (end - begin) > 1) {
+            double font_size = font_size_sum / (end - begin);
+
+            std::vector<uintmax_t> pieces;
+            Axis axis = X_AXIS;
+            bool found = split(begin, end, X_AXIS, X_GAP_RATIO * font_size, pieces);
+            if (!found) {
+                axis = Y_AXIS;
+                found = split(begin, end, Y_AXIS, Y_GAP_RATIO * font_size, pieces);
+            }
+
+            if (found) {
+                pieces.push_back(end);
+
+                std::vector<double> piece_font_size_sums;
+                reorder(begin, end, axis, pieces, piece_font_size_sums);
+
+                uintmax_t piece_begin = begin;
+                for (uintmax_t p = 0; p < pieces.size(); ++p) {
+                    cut(piece_begin, pieces[p], piece_font_size_sums[p], depth + 1, blocks);
+                    piece_begin = pieces[p];
+                }
+                return;
+            }
+        }
+
+        PdfTextBlock block;
+        for (uintmax_t ii = begin; ii < end; ++ii) {
+            const Item& item = items[by_x[ii]];
+            block.add_span(item.idx, item.bbox);
+        }
+        block.sort_spans();
+        blocks.push_back(block);
+    }
+
+    //
+    // projects the items on the axis and looks for gaps in the
+    // profile. Items are sorted by their start so each gap is a
+    // split point between two contiguous ranges. Returns true if
+    // any were found
+    bool BlockSegmenter::split(uintmax_t begin, uintmax_t end, Axis axis, double min_gap,
+                               std::vector<uintmax_t>& pieces) const
+    {
+        const std::vector<uintmax_t>& sorted = (axis == X_AXIS ? by_x : by_y);
+
+        // extent of the region across the axis - rulings must cover
+        // a good part of it to count
+        Axis across = (axis == X_AXIS ? Y_AXIS : X_AXIS);
+        const Item& first = items[sorted[begin]];
+        double region_lo = first.lo(across), region_hi = first.hi(across);
+        for (uintmax_t ii = begin + 1; ii < end; ++ii) {
+            const Item& item = items[sorted[ii]];
+            region_lo = std::min(region_lo, item.lo(across));
+            region_hi = std::max(region_hi, item.hi(across));
+        }
+
+        const std::vector<Ruling>& rulings = (axis == X_AXIS ? v_rulings : h_rulings);
+
+        // collect the gaps wide enough to cut at. A gap with a
+        // ruling in it counts as the minimum width
+        std::vector< std::pair<uintmax_t, double> > gaps;
+        double widest = 0;
+        double run_hi = first.hi(axis);
+        for (uintmax_t ii = begin + 1; ii < end; ++ii) {
+            const Item& item = items[sorted[ii]];
+            double gap = item.lo(axis) - run_hi;
+            if (gap < min_gap && gap > 0 && ruling_in_gap(rulings, run_hi, item.lo(axis), region_lo, region_hi)) {
+                gap = min_gap;
+            }
+            if (gap >= min_gap) {
+                gaps.push_back( std::make_pair(ii, gap) );
+                widest = std::max(widest, gap);
+            }
+            run_hi = std::max(run_hi, item.hi(axis));
+        }
+
+        // only cut at the widest gaps so nested structure is found
+        // in order (e.g., a title, then columns, then paragraphs
+        // within each column)
+        for (const std::pair<uintmax_t, double>& g : gaps) {
+            if (g.second >= widest * WIDEST_GAP_TOLERANCE) {
+                pieces.push_back(g.first);
+            }
+        }
+        return !pieces.empty();
+    }
+
+    //
+    // the region was split into contiguous pieces of the axis' order
+    // (pieces holds their ends). Rearrange the other axis' order to
+    // match, keeping each piece sorted, and sum each piece's font
+    // sizes
+    void BlockSegmenter::reorder(uintmax_t begin, uintmax_t end, Axis axis, const std::vector<uintmax_t>& pieces,
+                                 std::vector<double>& font_size_sums)
+    {
+        const std::vector<uintmax_t>& split_order = (axis == X_AXIS ? by_x : by_y);
+        std::vector<uintmax_t>& other_order = (axis == X_AXIS ? by_y : by_x);
+
+        font_size_sums.assign(pieces.size(), 0);
+        uintmax_t piece = 0;
+        for (uintmax_t ii = begin; ii < end; ++ii) {
+            if (ii == pieces[piece]) {
+                ++piece;
+            }
+            piece_of[split_order[ii]] = piece;
+            font_size_sums[piece] += items[split_order[ii]].font_size;
+        }
+
+        std::vector<uintmax_t> next(pieces.size());
+        next[0] = begin;
+        for (uintmax_t p = 1; p < pieces.size(); ++p) {
+            next[p] = pieces[p - 1];
+        }
+        scratch.assign(other_order.begin() + begin, other_order.begin() + end);
+        for (uintmax_t i : scratch) {
+            other_order[ next[piece_of[i]]++ ] = i;
+        }
+    }
+
+    //
+    // is there a ruling line inside the gap that spans at least half
+    // of the region?
+    bool BlockSegmenter::ruling_in_gap(const std::vector<Ruling>& rulings, double gap_lo, double gap_hi,
+                                       double region_lo, double region_hi) const
+    {
+        Ruling key = { gap_lo, 0, 0 };
+        for (auto ii = std::lower_bound(rulings.begin(), rulings.end(), key);
+             ii != rulings.end() && ii->pos <= gap_hi; ++ii) {
+            double overlap = std::min(ii->hi, region_hi) - std::max(ii->lo, region_lo);
+            if (overlap >= (region_hi - region_lo) / 2) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+} // namespace
@@ -0,0 +1,120 @@
+//
+// Copyright 2016-2017 Ed Porras
+//
+// This file is part of pdftoedn.
+//
+// pdftoedn is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// pdftoedn is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with pdftoedn.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <ostream>
+#include <vector>
+
+#include "base_types.h"
+
+namespace pdftoedn
+{
+    class PdfText;
+
+    // -------------------------------------------------------
+    // a block of text found by page segmentation. Refers to the
+    // page's spans by index
+    //
+    class PdfTextBlock : public gemable {
+    public:
+        void add_span(uintmax_t span_idx, const BoundingBox& bbox) {
+            spans.push_back(span_idx);
+            bounds.expand(bbox);
+        }
+        void sort_spans();
+
+        std::ostream& to_edn(std::ostream& o) const;
+
+    private:
+        pdftoedn::Bounds bounds;
+        std::vector<uintmax_t> spans;
+    };
+
+
+    // -------------------------------------------------------
+    // recursive XY-cut segmentation of a page's text. Spans are
+    // projected on each axis and the region is split at the widest
+    // gaps that separate columns (vertical cuts, tried first) or
+    // paragraphs (horizontal cuts). Ruling lines that run through a
+    // gap let it be used as a cut even if it is narrow. Blocks are
+    // produced in reading order: top to bottom, left to right.
+    // Spans are sorted once per axis and regions keep both orders as
+    // they are split, so each level of cuts is linear: O(n log n +
+    // MAX_DEPTH * n) overall
+    //
+    class BlockSegmenter {
+    public:
+        BlockSegmenter(const std::vector<PdfText *>& text_spans,
+                       const std::vector<BoundingBox>& rulings);
+
+        void segment(std::vector<PdfTextBlock>& blocks);
+
+        // min. gap for a cut as a factor of the region's mean font
+        // size
+        static const double X_GAP_RATIO;
+        static const double Y_GAP_RATIO;
+        // gaps at least this fraction of the widest one are all cut
+        // at once
+        static const double WIDEST_GAP_TOLERANCE;
+
+        // max. thickness of a path to be considered a ruling line
+        static const double RULING_MAX_THICKNESS;
+
+    private:
+        enum Axis { X_AXIS, Y_AXIS };
+        enum { MAX_DEPTH = 32 };
+
+        struct Item {
+            Item(const BoundingBox& b, double size, uintmax_t span_idx) :
+                bbox(b), font_size(size), idx(span_idx)
+            { }
+
+            double lo(Axis a) const { return (a == X_AXIS ? bbox.x_min() : bbox.y_min()); }
+            double hi(Axis a) const { return (a == X_AXIS ? bbox.x_max() : bbox.y_max()); }
+
+            BoundingBox bbox;
+            double font_size;
+            uintmax_t idx;
+        };
+
+        // rulings are kept sorted by their position across the axis
+        // they separate
+        struct Ruling {
+            double pos, lo, hi;
+            bool operator<(const Ruling& r) const { return (pos < r.pos); }
+        };
+
+        std::vector<Item> items;
+        // items sorted by their start on each axis. A region is the
+        // same range of both
+        std::vector<uintmax_t> by_x, by_y;
+        std::vector<uintmax_t> piece_of, scratch;
+        std::vector<Ruling> h_rulings, v_rulings;
+
+        void cut(uintmax_t begin, uintmax_t end, double font_size_sum, uintmax_t depth,
+                 std::vector<PdfTextBlock>& blocks);
+        bool split(uintmax_t begin, uintmax_t end, Axis axis, double min_gap,
+                   std::vector<uintmax_t>& pieces) const;
+        void reorder(uintmax_t begin, uintmax_t end, Axis axis, const std::vector<uintmax_t>& pieces,
+                     std::vector<double>& font_size_sums);
+        bool ruling_in_gap(const std::vector<Ruling>& rulings, double gap_lo, double gap_hi,
+                           double region_lo, double region_hi) const;
+    };
+
+} // namespace
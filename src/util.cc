@@ -100,6 +100,41 @@ namespace pdftoedn
             return boost::locale::conv::utf_to_utf<char>(w_str);
         }
 
+        // -------------------------------------------------------------------------------
+        // encode UTF-32 code points as UTF-8, appending to
+        // utf_str. Invalid code points (surrogates and values past
+        // 0x10FFFF) are skipped - same as utf_to_utf's default
+        //
+        std::string& utf32_to_utfstring(const std::u32string& u32_str, std::string& utf_str)
+        {
+            utf_str.reserve(utf_str.size() + u32_str.size());
+
+            for (char32_t c : u32_str) {
+                if (c < 0x80) {
+                    utf_str += static_cast<char>(c);
+                }
+                else if (c < 0x800) {
+                    utf_str += static_cast<char>(0xc0 | (c >> 6));
+                    utf_str += static_cast<char>(0x80 | (c & 0x3f));
+                }
+                else if (c < 0x10000) {
+                    if (c >= 0xd800 && c <= 0xdfff) {
+                        continue;
+                    }
+                    utf_str += static_cast<char>(0xe0 | (c >> 12));
+                    utf_str += static_cast<char>(0x80 | ((c >> 6) & 0x3f));
+                    utf_str += static_cast<char>(0x80 | (c & 0x3f));
+                }
+                else if (c <= 0x10ffff) {
+                    utf_str += static_cast<char>(0xf0 | (c >> 18));
+                    utf_str += static_cast<char>(0x80 | ((c >> 12) & 0x3f));
+                    utf_str += static_cast<char>(0x80 | ((c >> 6) & 0x3f));
+                    utf_str += static_cast<char>(0x80 | (c & 0x3f));
+                }
+            }
+            return utf_str;
+        }
+
         //
         // convert poppler's Unicode to wstring
         std::wstring unicode_to_wstring(const Unicode* const u, int len)
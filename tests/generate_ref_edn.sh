@@ -40,3 +40,35 @@ for file in ${TESTS_DIR}/docs/*.edn.bz2; do
         [ $? -eq 0 ] && echo "Compressed $REFEDN"
     fi
 done
+
+# and the option runs
+mkdir -p "${TESTS_DIR}/docs/options"
+while read NAME DOC EXPECTED ARGS; do
+    [ -z "$NAME" ] && continue
+
+    REFEDN="${TESTS_DIR}/docs/options/${NAME}.edn"
+    SRCPDF="${TESTS_DIR}/docs/${DOC}"
+    FONTMAP="${SRCPDF%.*}.json"
+
+    ARGS="-f $ARGS"
+
+    if [ -f "$FONTMAP" ]; then
+        # use the specified fontmap if it exists
+        ARGS="$ARGS -m "$FONTMAP""
+    fi
+
+    # process EDN
+    run_cmd "${PDFTOEDN} $ARGS -o "$REFEDN" "$SRCPDF""
+    status=$?
+
+    filter_meta "$REFEDN" edn.tmp
+    mv edn.tmp "$REFEDN"
+
+    if [ $status -eq 0 ]; then
+        # compress ouptut
+        bzip2 -f "$REFEDN"
+        [ $? -eq 0 ] && echo "Compressed $REFEDN"
+    fi
+done <<END_OF_TESTS
+$OPTION_TESTS
+END_OF_TESTS
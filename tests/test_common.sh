@@ -5,6 +5,32 @@ STDOUTFILE=out.tmp
 TESTDOC=${TESTS_DIR}/docs/HUN.pdf
 TEST_ENCDOC=${TESTS_DIR}/docs/enc_test.pdf
 
+# runs of the docs (mostly with output options), each compared to
+# its own reference output in docs/options. One per line:
+#   <reference name> <doc> <expected> [<pdftoedn args>]
+# <expected> is a string the output must contain, showing the run's
+# option took effect, or one it must not contain when prefixed with '!'
+OPTION_TESTS="
+HUN-text_lines HUN.pdf :lines -L
+HUN-text_blocks HUN.pdf :blocks -B
+HUN-x_deltas HUN.pdf :x_deltas -x 100
+options_test-shared_content options_test.pdf :shared_content -s
+HUN-compact_paths HUN.pdf :rect -c
+options_test-gradients options_test.pdf :shading -g
+options_test-tiling_patterns options_test.pdf :pattern_id -P
+options_test-forms options_test.pdf :form_id -X
+options_test-symbols options_test.pdf :symbols -S
+options_test-lod options_test.pdf :decimated -M 200
+options_test-lod_coarse options_test.pdf :decimated -M 10 -r 2
+nup_test nup_test.pdf !Hidden
+nup_test-cull_chars nup_test.pdf !sheet\" -C
+nup_test-gradients nup_test.pdf !:shading -g
+forms_test forms_test.pdf !:form_id
+forms_test-forms forms_test.pdf :form_id -X
+forms_test-tiling_patterns forms_test.pdf :pattern_id -P
+glyphs_test glyphs_test.pdf :glyph_idx
+"
+
 DIFF="diff"
 RM="rm -f"
 BZIP2="bzip2 -k"
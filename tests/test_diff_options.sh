@@ -0,0 +1,89 @@
+#!/bin/sh
+
+[ "x${TESTS_DIR}" = "x" ] && TESTS_DIR="."
+. ${TESTS_DIR}/test_common.sh
+
+test_start
+
+# process the docs with each of the output options, check the output
+# shows the option took effect and compare it to the one saved for
+# that run
+status=0
+missing=0
+while read NAME DOC EXPECTED ARGS
+do
+    [ -z "$NAME" ] && continue
+
+    REFEDN="${TESTS_DIR}/docs/options/${NAME}.edn"
+    SRCPDF="${TESTS_DIR}/docs/${DOC}"
+    FONTMAP="${SRCPDF%.*}.json"
+
+    ARGS="-f $ARGS"
+
+    # if there's a fontmap available for the doc, use it
+    if [ -f "$FONTMAP" ]; then
+        ARGS="$ARGS -m "$FONTMAP""
+    fi
+
+    # process the PDF
+    run_cmd "$PDFTOEDN $ARGS -o "$TMPFILE" "$SRCPDF""
+    status=$?
+
+    if [ $status -ne 0 ]; then
+        echo "\tError processing file $SRCPDF"
+        break
+    fi
+
+    # check for (or against) the string showing the option's effect
+    if [ "${EXPECTED#!}" != "$EXPECTED" ]; then
+        grep -F -q -e "${EXPECTED#!}" "$TMPFILE" && status=1
+    else
+        grep -F -q -e "$EXPECTED" "$TMPFILE" || status=1
+    fi
+
+    if [ $status -ne 0 ]; then
+        echo " -> File output for $SRCPDF ($ARGS) failed expectation '$EXPECTED'"
+        break
+    fi
+
+    # reference output is generated with 'make ref-edn'
+    if [ ! -f "$REFEDN.bz2" ]; then
+        echo " -> Missing reference output $REFEDN.bz2 for $SRCPDF $ARGS"
+        missing=1
+        continue
+    fi
+
+    # uncompress the reference output if needed
+    if [ ! -f "$REFEDN" ]; then
+        $BUNZIP2 "$REFEDN.bz2"
+    fi
+
+    # remove the filename string and version strings hash so it
+    # doesn't cause diff output on version bumps
+    filter_meta "$TMPFILE" t1.tmp
+
+    # diff them
+    $DIFF t1.tmp "$REFEDN" &> /dev/null
+    status=$?
+
+    $RM t1.tmp
+    if [ $status -ne 0 ]; then
+        echo " -> File output for $SRCPDF ($ARGS) did not match reference output $REFEDN"
+        break
+    fi
+
+    echo
+done <<END_OF_TESTS
+$OPTION_TESTS
+END_OF_TESTS
+
+test_end
+
+# runs that met their expectation but have no reference output to
+# diff against are reported as skipped (77)
+if [ $status -eq 0 ] && [ $missing -ne 0 ]; then
+    exit 77
+fi
+
+# returns last run's status
+exit $status